@@ -0,0 +1,66 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#include "bayer-converter.hpp"
+
+static constexpr int32_t codeOf(const FrameFormat::BayerPattern pattern, const BayerConverter::Output output)
+{
+    const bool gray = (output == BayerConverter::Output::GRAY);
+    switch (pattern)
+    {
+        case FrameFormat::BayerPattern::GBRG:
+            return gray ? cv::COLOR_BayerGBRG2GRAY : cv::COLOR_BayerGBRG2BGR;
+
+        case FrameFormat::BayerPattern::RGGB:
+            return gray ? cv::COLOR_BayerRGGB2GRAY : cv::COLOR_BayerRGGB2BGR;
+
+        case FrameFormat::BayerPattern::GRBG:
+            return gray ? cv::COLOR_BayerGRBG2GRAY : cv::COLOR_BayerGRBG2BGR;
+
+        case FrameFormat::BayerPattern::BGGR:
+            return gray ? cv::COLOR_BayerBGGR2GRAY : cv::COLOR_BayerBGGR2BGR;
+
+        default:
+            return -1;
+    }
+}
+
+int32_t BayerConverter::conversionCode(const FrameFormat::BayerPattern pattern, const Output output)
+{
+    return codeOf(pattern, output);
+}
+
+void BayerConverter::convert(const cv::Mat& source, const FrameFormat::BayerPattern pattern, const Output output, cv::Mat& destination)
+{
+    const int32_t code = conversionCode(pattern, output);
+    if ((output == Output::NONE) || (code < 0))
+    {
+        // nothing to convert, i.e. not a bayer frame
+        //
+        source.copyTo(destination);
+        return;
+    }
+
+    cv::cvtColor(source, destination, code);
+}
+
+template<FrameFormat::BayerPattern Pattern, BayerConverter::Output To>
+void BayerConverter::convert(const cv::Mat& source, const FrameFormat::BayerPattern, const Output, cv::Mat& destination)
+{
+    static_assert((Pattern != FrameFormat::BayerPattern::NONE) && (To != Output::NONE), "The specialised conversion must be of a bayer pattern");
+
+    // note, as for convert(), the destination is only (re)allocated if its size or type has changed
+    //
+    constexpr int32_t code = codeOf(Pattern, To);
+    cv::cvtColor(source, destination, code);
+}
+
+template void BayerConverter::convert<FrameFormat::BayerPattern::GBRG, BayerConverter::Output::BGR>(const cv::Mat&, const FrameFormat::BayerPattern, const Output, cv::Mat&);
+template void BayerConverter::convert<FrameFormat::BayerPattern::RGGB, BayerConverter::Output::BGR>(const cv::Mat&, const FrameFormat::BayerPattern, const Output, cv::Mat&);
+template void BayerConverter::convert<FrameFormat::BayerPattern::GRBG, BayerConverter::Output::BGR>(const cv::Mat&, const FrameFormat::BayerPattern, const Output, cv::Mat&);
+template void BayerConverter::convert<FrameFormat::BayerPattern::BGGR, BayerConverter::Output::BGR>(const cv::Mat&, const FrameFormat::BayerPattern, const Output, cv::Mat&);
+template void BayerConverter::convert<FrameFormat::BayerPattern::GBRG, BayerConverter::Output::GRAY>(const cv::Mat&, const FrameFormat::BayerPattern, const Output, cv::Mat&);
+template void BayerConverter::convert<FrameFormat::BayerPattern::RGGB, BayerConverter::Output::GRAY>(const cv::Mat&, const FrameFormat::BayerPattern, const Output, cv::Mat&);
+template void BayerConverter::convert<FrameFormat::BayerPattern::GRBG, BayerConverter::Output::GRAY>(const cv::Mat&, const FrameFormat::BayerPattern, const Output, cv::Mat&);
+template void BayerConverter::convert<FrameFormat::BayerPattern::BGGR, BayerConverter::Output::GRAY>(const cv::Mat&, const FrameFormat::BayerPattern, const Output, cv::Mat&);
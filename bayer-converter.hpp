@@ -0,0 +1,35 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#ifndef H_BAYER_CONVERTER
+#define H_BAYER_CONVERTER
+
+#include <cstdint>
+
+#include <opencv2/opencv.hpp>
+
+#include "frame-format.hpp"
+
+// demosaics the bayer frames produced by the tcam sources, i.e. gbrg, rggb, grbg and bggr in 8 or 16 bit containers
+// notes 1, this is deliberately a wrapper of cv::cvtColor() (i.e. the OpenCV bilinear demosaicing), so the results are those of cv::cvtColor() by construction
+//          the 8 bit kernel is vectorised (NEON or SSE via the OpenCV universal intrinsics), the 16 bit kernel is scalar
+//          both are tiled into row stripes that are processed in parallel using cv::parallel_for_()
+//       2, the destination is only (re)allocated if its size or type has changed, i.e. it should be a preallocated buffer
+//       3, GigEVideoCapture converts on the consumer's thread (or a subscriber worker) rather than on the streaming thread, see setOutputConversion()
+//       4, convert<Pattern, To>() is the kernel specialised for a pixel format (i.e. the conversion code is a constant), its pattern and output arguments are ignored
+//
+class BayerConverter
+{
+    public:
+        enum class Output { NONE, BGR, GRAY };
+
+        using Kernel = void (*)(const cv::Mat& source, const FrameFormat::BayerPattern pattern, const Output output, cv::Mat& destination);
+
+        static int32_t conversionCode(const FrameFormat::BayerPattern pattern, const Output output);
+        static void convert(const cv::Mat& source, const FrameFormat::BayerPattern pattern, const Output output, cv::Mat& destination);
+        template<FrameFormat::BayerPattern Pattern, Output To>
+        static void convert(const cv::Mat& source, const FrameFormat::BayerPattern pattern, const Output output, cv::Mat& destination);
+};
+
+#endif
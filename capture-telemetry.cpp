@@ -0,0 +1,267 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#include "capture-telemetry.hpp"
+
+void LatencyHistogram::record(const uint64_t nanoseconds)
+{
+    buckets[bucketIndex(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(nanoseconds, std::memory_order_relaxed);
+
+    uint64_t current = max.load(std::memory_order_relaxed);
+    while ((nanoseconds > current) && !max.compare_exchange_weak(current, nanoseconds, std::memory_order_relaxed));
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const
+{
+    auto counts = std::array<uint64_t, BUCKETS>();
+    uint64_t total = 0;
+    for (size_t i = 0; i < BUCKETS; i++)
+    {
+        counts[i] = buckets[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+
+    auto result = Snapshot();
+    result.count = total;
+    result.max = max.load(std::memory_order_relaxed);
+    if (total == 0) return result;
+
+    result.mean = double(sum.load(std::memory_order_relaxed)) / double(count.load(std::memory_order_relaxed));
+
+    // note, reports the upper bound of the bucket containing the percentile, clamped to the recorded maximum
+    //
+    const auto percentile = [&counts, total, &result](const double fraction) {
+        const auto rank = uint64_t(fraction * double(total - 1)) + 1;
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i < BUCKETS; i++)
+        {
+            cumulative += counts[i];
+            if (cumulative >= rank) return std::min(bucketUpperBound(i), result.max);
+        }
+
+        return result.max;
+    };
+
+    result.p50 = percentile(0.5);
+    result.p90 = percentile(0.9);
+    result.p99 = percentile(0.99);
+    result.p999 = percentile(0.999);
+
+    return result;
+}
+
+void LatencyHistogram::reset()
+{
+    for (auto& bucket : buckets) bucket.store(0, std::memory_order_relaxed);
+    count.store(0, std::memory_order_relaxed);
+    sum.store(0, std::memory_order_relaxed);
+    max.store(0, std::memory_order_relaxed);
+}
+
+size_t LatencyHistogram::bucketIndex(const uint64_t nanoseconds)
+{
+    // notes 1, values 0 to 3 each have their own bucket
+    //       2, otherwise the 2 bits below the most significant bit select one of 4 sub-buckets within the power of 2
+    //
+    if (nanoseconds < 4) return nanoseconds;
+
+    const size_t msb = 63 - __builtin_clzll(nanoseconds);
+    const size_t sub = (nanoseconds >> (msb - 2)) & 3;
+
+    return std::min(((msb - 1) * 4) + sub, BUCKETS - 1);
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(const size_t index)
+{
+    if (index < 4) return index;
+
+    const size_t msb = (index / 4) + 1;
+    const uint64_t width = uint64_t(1) << (msb - 2);
+
+    return ((4 + (index % 4)) * width) + width - 1;
+}
+
+std::string CaptureTelemetry::Snapshot::toString() const
+{
+    const auto latency = [](const LatencyHistogram::Snapshot& histogram) {
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(3);
+        ss << "mean " << (histogram.mean / 1000000.0) << " ms, ";
+        ss << "p50 " << (histogram.p50 / 1000000.0) << " ms, ";
+        ss << "p99 " << (histogram.p99 / 1000000.0) << " ms, ";
+        ss << "max " << (histogram.max / 1000000.0) << " ms";
+
+        return ss.str();
+    };
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(2);
+    ss << "Capture Telemetry (" << elapsed << " s):\n";
+    ss << "  Received: " << received << " (" << receivedFrameRate << " fps), Delivered: " << delivered << " (" << deliveredFrameRate << " fps)\n";
+    ss << "  Discarded: " << discarded << ", Dropped: " << dropped << ", Unchanged: " << unchanged << ", Camera Dropped: " << cameraDropped << ", Camera Gaps: " << cameraGaps << "\n";
+    ss << "  Failures: sample " << sampleFailures << ", map " << mapFailures << ", caps " << capsFailures << "\n";
+    ss << "  Handler Latency: " << latency(handlerLatency) << "\n";
+    ss << "  Delivery Latency: " << latency(deliveryLatency) << "\n";
+    ss << "  Transport Latency: " << latency(transportLatency) << "\n";
+    ss << std::setprecision(3);
+    ss << "  Time To First Frame: cold " << (coldStartLatency / 1000000.0) << " ms, warm " << (warmStartLatency / 1000000.0) << " ms, reconfigure " << (reconfigureLatency / 1000000.0) << " ms\n";
+
+    return ss.str();
+}
+
+CaptureTelemetry::Scope::Scope(LatencyHistogram& latencyHistogram):
+    histogram(latencyHistogram), start(CaptureTelemetry::now())
+{
+}
+
+CaptureTelemetry::Scope::~Scope()
+{
+    histogram.record(CaptureTelemetry::now() - start);
+}
+
+CaptureTelemetry::CaptureTelemetry():
+    startTime(now())
+{
+}
+
+uint64_t CaptureTelemetry::now()
+{
+    // note, the steady clock is CLOCK_MONOTONIC, in nanoseconds
+    //
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void CaptureTelemetry::recordCameraCounters(const uint64_t frameCount, const uint64_t framesDropped)
+{
+    // notes 1, only called by the handler(), i.e. from the gstreamer streaming thread
+    //       2, the camera's counters are cumulative, a gap in the frame count is a frame lost between the camera and the handler()
+    //
+    cameraDropped.store(framesDropped, std::memory_order_relaxed);
+    if (cameraFrameCountValid && (frameCount > (lastCameraFrameCount + 1))) cameraGaps.fetch_add(frameCount - lastCameraFrameCount - 1, std::memory_order_relaxed);
+
+    lastCameraFrameCount = frameCount;
+    cameraFrameCountValid = true;
+}
+
+void CaptureTelemetry::recordDelivery(const uint64_t sequence, const uint64_t arrivalTime)
+{
+    // notes 1, a frame is only counted by its 1st delivery, i.e. the delivered fps is not inflated when there are several subscribers
+    //       2, each consumer receives its frames in sequence, so a frame is counted if it is later than every frame already counted
+    //          i.e. a frame that is only delivered after a later frame has been delivered (to another consumer) is not counted
+    //
+    uint64_t next = nextDelivered.load(std::memory_order_relaxed);
+    while (sequence >= next)
+    {
+        if (nextDelivered.compare_exchange_weak(next, sequence + 1, std::memory_order_relaxed))
+        {
+            delivered.fetch_add(1, std::memory_order_relaxed);
+            break;
+        }
+    }
+
+    if (arrivalTime > 0) deliveryLatency.record(now() - arrivalTime);
+}
+
+void CaptureTelemetry::startupBegin(const Startup kind)
+{
+    // note, called just before the pipeline state change, the time to first frame is then recorded by the handler()
+    //
+    startupKind.store(kind);
+    startupTime.store(now());
+    firstFramePending.store(true);
+}
+
+void CaptureTelemetry::recordFirstFrame(const uint64_t arrivalTime)
+{
+    // note, called by the handler() for every frame, so only the flag is checked until a startup is pending
+    //
+    if (!firstFramePending.load(std::memory_order_relaxed) || !firstFramePending.exchange(false)) return;
+
+    const uint64_t begin = startupTime.load();
+    if (arrivalTime > begin) startupLatency[static_cast<size_t>(startupKind.load())].store(arrivalTime - begin);
+}
+
+CaptureTelemetry::Snapshot CaptureTelemetry::snapshot() const
+{
+    auto result = Snapshot();
+    result.elapsed = (now() - startTime.load()) / 1000000000.0;
+    result.received = received.load();
+    result.delivered = delivered.load();
+    result.discarded = discarded.load();
+    result.dropped = dropped.load();
+    result.unchanged = unchanged.load();
+    result.cameraDropped = cameraDropped.load();
+    result.cameraGaps = cameraGaps.load();
+    result.sampleFailures = sampleFailures.load();
+    result.mapFailures = mapFailures.load();
+    result.capsFailures = capsFailures.load();
+    result.handlerLatency = handlerLatency.snapshot();
+    result.deliveryLatency = deliveryLatency.snapshot();
+    result.transportLatency = transportLatency.snapshot();
+    result.coldStartLatency = startupLatency[static_cast<size_t>(Startup::COLD_START)].load();
+    result.warmStartLatency = startupLatency[static_cast<size_t>(Startup::WARM_START)].load();
+    result.reconfigureLatency = startupLatency[static_cast<size_t>(Startup::RECONFIGURE)].load();
+
+    if (result.elapsed > 0.0)
+    {
+        result.receivedFrameRate = result.received / result.elapsed;
+        result.deliveredFrameRate = result.delivered / result.elapsed;
+    }
+
+    return result;
+}
+
+void CaptureTelemetry::reset()
+{
+    // note, the camera's counters are cumulative and so are not reset
+    //
+    received.store(0);
+    delivered.store(0);
+    discarded.store(0);
+    dropped.store(0);
+    unchanged.store(0);
+    cameraGaps.store(0);
+    sampleFailures.store(0);
+    mapFailures.store(0);
+    capsFailures.store(0);
+    handlerLatency.reset();
+    deliveryLatency.reset();
+    transportLatency.reset();
+    startTime.store(now());
+}
+
+void CaptureTelemetry::startDump(const std::chrono::milliseconds interval, std::ostream& stream)
+{
+    stopDump();
+
+    dumpStopping = false;
+    dumpThread = std::thread([this, interval, &stream] {
+        std::unique_lock<std::mutex> lock(dumpMutex);
+        while (!dumpCondition.wait_for(lock, interval, [this] { return dumpStopping; })) stream << snapshot().toString() << std::flush;
+    });
+}
+
+void CaptureTelemetry::stopDump()
+{
+    if (!dumpThread.joinable()) return;
+
+    {
+        std::scoped_lock<std::mutex> lock(dumpMutex);
+        dumpStopping = true;
+    }
+
+    dumpCondition.notify_one();
+    dumpThread.join();
+}
+
+CaptureTelemetry::~CaptureTelemetry()
+{
+    stopDump();
+}
@@ -0,0 +1,156 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#ifndef H_CAPTURE_TELEMETRY
+#define H_CAPTURE_TELEMETRY
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+
+// a lock free latency histogram, using 4 linear sub-buckets per power of 2 nanoseconds (i.e. a worst case error of 25%)
+//
+class LatencyHistogram
+{
+    public:
+        struct Snapshot
+        {
+            uint64_t count = 0;
+            double mean = 0.0;
+            uint64_t max = 0;
+            uint64_t p50 = 0;
+            uint64_t p90 = 0;
+            uint64_t p99 = 0;
+            uint64_t p999 = 0;
+        };
+
+    private:
+        static constexpr size_t BUCKETS = 252;
+
+        std::array<std::atomic<uint64_t>, BUCKETS> buckets = {};
+        std::atomic<uint64_t> count = 0;
+        std::atomic<uint64_t> sum = 0;
+        std::atomic<uint64_t> max = 0;
+
+    public:
+        void record(const uint64_t nanoseconds);
+        Snapshot snapshot() const;
+        void reset();
+
+    private:
+        static size_t bucketIndex(const uint64_t nanoseconds);
+        static uint64_t bucketUpperBound(const size_t index);
+};
+
+// the capture telemetry, updated by the handler() and the grab() / subscriber delivery paths
+// notes 1, all of the counters are lock free, the snapshot is therefore not atomic as a whole (the counters are individually consistent)
+//       2, received, every sample pulled from the appsink
+//          delivered, frames delivered to a consumer, each frame is counted once however many consumers (grabs and subscribers) it is delivered to
+//          discarded, frames thrown away as no grab() was pending (ON_DEMAND) or skipped by GrabPolicy::LATEST
+//          dropped, frames lost as the CONTINUOUS capture ring was full
+//          unchanged, frames suppressed by the change detection gate, see ChangeDetector
+//          cameraDropped, as reported by the camera / driver in the TcamStatisticsMeta
+//          cameraGaps, frames missing from the camera's frame count sequence
+//       3, the handler latency is the time spent in the handler(), the delivery latency is from the frame arriving to it being delivered (to each consumer)
+//          the transport latency is from the (clock correlated) exposure to the frame arriving, see ClockCorrelator
+//       4, the time to first frame is from a start() (cold from NULL / READY, or warm from PAUSED) or a reconfigure() to the 1st frame arriving
+//          only the most recent measurement of each is kept, and they are not cleared by reset()
+//
+class CaptureTelemetry
+{
+    public:
+        enum class Startup { COLD_START, WARM_START, RECONFIGURE };
+
+        struct Snapshot
+        {
+            double elapsed = 0.0;
+            uint64_t received = 0;
+            uint64_t delivered = 0;
+            uint64_t discarded = 0;
+            uint64_t dropped = 0;
+            uint64_t unchanged = 0;
+            uint64_t cameraDropped = 0;
+            uint64_t cameraGaps = 0;
+            uint64_t sampleFailures = 0;
+            uint64_t mapFailures = 0;
+            uint64_t capsFailures = 0;
+            double receivedFrameRate = 0.0;
+            double deliveredFrameRate = 0.0;
+            LatencyHistogram::Snapshot handlerLatency;
+            LatencyHistogram::Snapshot deliveryLatency;
+            LatencyHistogram::Snapshot transportLatency;
+            uint64_t coldStartLatency = 0;
+            uint64_t warmStartLatency = 0;
+            uint64_t reconfigureLatency = 0;
+
+            std::string toString() const;
+        };
+
+        // times the enclosing scope, i.e. the handler()
+        //
+        class Scope
+        {
+            private:
+                LatencyHistogram& histogram;
+                const uint64_t start;
+
+            public:
+                Scope(LatencyHistogram& latencyHistogram);
+                ~Scope();
+        };
+
+        std::atomic<uint64_t> received = 0;
+        std::atomic<uint64_t> delivered = 0;
+        std::atomic<uint64_t> discarded = 0;
+        std::atomic<uint64_t> dropped = 0;
+        std::atomic<uint64_t> unchanged = 0;
+        std::atomic<uint64_t> cameraDropped = 0;
+        std::atomic<uint64_t> cameraGaps = 0;
+        std::atomic<uint64_t> sampleFailures = 0;
+        std::atomic<uint64_t> mapFailures = 0;
+        std::atomic<uint64_t> capsFailures = 0;
+        LatencyHistogram handlerLatency;
+        LatencyHistogram deliveryLatency;
+        LatencyHistogram transportLatency;
+
+    private:
+        std::atomic<uint64_t> startTime;
+        std::array<std::atomic<uint64_t>, 3> startupLatency = {};
+        std::atomic<uint64_t> startupTime = 0;
+        std::atomic<Startup> startupKind = Startup::COLD_START;
+        std::atomic<bool> firstFramePending = false;
+        std::atomic<uint64_t> nextDelivered = 0;
+        uint64_t lastCameraFrameCount = 0;
+        bool cameraFrameCountValid = false;
+
+        std::thread dumpThread;
+        std::mutex dumpMutex;
+        std::condition_variable dumpCondition;
+        bool dumpStopping = false;
+
+    public:
+        CaptureTelemetry();
+
+        static uint64_t now();
+
+        void recordCameraCounters(const uint64_t frameCount, const uint64_t framesDropped);
+        void recordDelivery(const uint64_t sequence, const uint64_t arrivalTime);
+        void startupBegin(const Startup kind);
+        void recordFirstFrame(const uint64_t arrivalTime);
+        Snapshot snapshot() const;
+        void reset();
+
+        void startDump(const std::chrono::milliseconds interval, std::ostream& stream);
+        void stopDump();
+
+        ~CaptureTelemetry();
+};
+
+#endif
@@ -0,0 +1,119 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#include <algorithm>
+
+#include "change-detector.hpp"
+
+ChangeDetector::ChangeDetector()
+{
+    setOptions(Options());
+}
+
+void ChangeDetector::setOptions(const Options& detectorOptions)
+{
+    // note, restarts the detection, i.e. the next frame is always treated as changed
+    //
+    std::scoped_lock<std::mutex> lock(mutex);
+    options = detectorOptions;
+    options.gridStep = std::max(options.gridStep, 1);
+    enabled.store(options.enabled);
+    frameType = -1;
+}
+
+ChangeDetector::Options ChangeDetector::getOptions() const
+{
+    std::scoped_lock<std::mutex> lock(mutex);
+    return options;
+}
+
+bool ChangeDetector::isEnabled() const
+{
+    return enabled.load(std::memory_order_relaxed);
+}
+
+ChangeDetector::Result ChangeDetector::detect(const cv::Mat& frame, const FrameFormat& format)
+{
+    // notes 1, called by the deliver() for each frame, returns the frame as changed if the detection is not enabled
+    //       2, the grid and reference are preallocated (and swapped), i.e. no allocation unless the frame size or type changes
+    //
+    auto result = Result();
+    std::scoped_lock<std::mutex> lock(mutex);
+    if (!options.enabled || frame.empty()) return result;
+
+    const bool restarted = (frame.size() != frameSize) || (frame.type() != frameType);
+    if (restarted) prepare(frame, format);
+
+    // the decimation, i.e. the frame is cropped to a whole number of grid steps so that the nearest neighbour resize samples exactly every step'th pixel
+    //
+    const auto cropped = frame(cv::Rect(0, 0, grid.cols * step, grid.rows * step));
+    cv::resize(cropped, grid, grid.size(), 0, 0, cv::INTER_NEAREST);
+
+    if (!restarted)
+    {
+        result.changed = false;
+        for (const auto& cell : cells)
+        {
+            const double difference = cv::norm(grid(cell.area), reference(cell.area), cv::NORM_L1) / (static_cast<double>(cell.area.area()) * grid.channels());
+            result.score = std::max(result.score, difference / cell.threshold);
+        }
+
+        result.changed = (result.score >= 1.0);
+        sinceChanged++;
+        if (!result.changed && (options.forcedInterval > 0) && (sinceChanged >= options.forcedInterval))
+        {
+            result.changed = true;
+            result.forced = true;
+        }
+    }
+
+    if (result.changed)
+    {
+        std::swap(grid, reference);
+        sinceChanged = 0;
+    }
+    else result.suppressed = (options.action == Action::SUPPRESS);
+
+    return result;
+}
+
+void ChangeDetector::prepare(const cv::Mat& frame, const FrameFormat& format)
+{
+    // (re)allocates the grid and maps the regions onto it, i.e. for the 1st frame or if the frame size or type has changed
+    // note, the caller must hold the lock
+    //
+    step = options.gridStep;
+    if (format.isBayer() && ((step % 2) != 0)) step++;
+
+    step = std::min(step, std::min(frame.cols, frame.rows));
+
+    frameSize = frame.size();
+    frameType = frame.type();
+    const auto gridSize = cv::Size(frame.cols / step, frame.rows / step);
+    grid.create(gridSize, frameType);
+    reference.create(gridSize, frameType);
+    sinceChanged = 0;
+
+    // a region with no grid samples (or a threshold of 0) is ignored, if there are no regions (or all are ignored) the whole frame is a single region
+    //
+    cells.clear();
+    const auto bounds = cv::Rect(0, 0, gridSize.width, gridSize.height);
+    for (const auto& region : options.regions)
+    {
+        const auto topLeft = cv::Point(region.area.x / step, region.area.y / step);
+        const auto bottomRight = cv::Point((region.area.x + region.area.width + step - 1) / step, (region.area.y + region.area.height + step - 1) / step);
+        const auto area = cv::Rect(topLeft, bottomRight) & bounds;
+        if ((area.area() > 0) && (region.threshold > 0.0)) cells.emplace_back(Cell{area, region.threshold});
+    }
+
+    if (cells.empty()) cells.emplace_back(Cell{bounds, std::max(options.threshold, 1e-9)});
+}
+
+void ChangeDetector::reset()
+{
+    // note, the next frame is treated as changed, i.e. becomes the new reference
+    //
+    std::scoped_lock<std::mutex> lock(mutex);
+    frameType = -1;
+}
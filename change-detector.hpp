@@ -0,0 +1,89 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#ifndef H_CHANGE_DETECTOR
+#define H_CHANGE_DETECTOR
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "frame-format.hpp"
+
+// a change detection gate, i.e. so that the frames of a static scene need not be grabbed, converted and processed
+// notes 1, each frame is decimated to a grid (every gridStep'th pixel of every gridStep'th row), which is compared to the grid of the last changed frame
+//          the decimation only touches the sampled pixels and the comparison is a sum of absolute differences (cv::norm(), i.e. NEON or SSE)
+//       2, the change is measured per region as the mean absolute difference of its grid samples, the frame has changed if any region exceeds its threshold
+//          by default there is a single region (the whole frame) using the threshold, a region can be given a lower threshold (more sensitive) or a higher one (less sensitive)
+//          a region outside the frame (or with a threshold of 0) is ignored, if every region is ignored the whole frame is again the single region
+//       3, the score is the largest ratio of a region's mean absolute difference to its threshold, i.e. the frame has changed if the score is 1 or more
+//       4, the thresholds are in the frame's own value range (i.e. 0 to 4095 for a 12 bit frame), for bayer frames the grid step is rounded up to even (i.e. the same bayer channel)
+//       5, the reference is the last changed (or forced) frame rather than the previous frame, i.e. a slow change accumulates until it is detected
+//       6, a frame is forced through (i.e. treated as changed) if forcedInterval frames have been gated since the last changed frame, 0 to never force a frame
+//
+class ChangeDetector
+{
+    public:
+        enum class Action { SUPPRESS, FLAG };
+
+        struct Region
+        {
+            cv::Rect area;
+            double threshold;
+        };
+
+        struct Options
+        {
+            bool enabled = false;
+            Action action = Action::SUPPRESS;
+            int32_t gridStep = 8;
+            double threshold = 4.0;
+            uint64_t forcedInterval = 30;
+            std::vector<Region> regions;
+        };
+
+        struct Result
+        {
+            bool changed = true;
+            bool forced = false;
+            bool suppressed = false;
+            double score = 0.0;
+        };
+
+    private:
+        struct Cell
+        {
+            cv::Rect area;
+            double threshold;
+        };
+
+        Options options;
+        std::atomic<bool> enabled = false;
+        std::vector<Cell> cells;
+        cv::Mat grid;
+        cv::Mat reference;
+        cv::Size frameSize;
+        int32_t frameType = -1;
+        int32_t step = 0;
+        uint64_t sinceChanged = 0;
+        mutable std::mutex mutex;
+
+    public:
+        ChangeDetector();
+
+        void setOptions(const Options& detectorOptions);
+        Options getOptions() const;
+        bool isEnabled() const;
+
+        Result detect(const cv::Mat& frame, const FrameFormat& format);
+        void reset();
+
+    private:
+        void prepare(const cv::Mat& frame, const FrameFormat& format);
+};
+
+#endif
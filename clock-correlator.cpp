@@ -0,0 +1,203 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "clock-correlator.hpp"
+
+ClockCorrelator::ClockCorrelator()
+{
+    setOptions(Options());
+}
+
+void ClockCorrelator::setOptions(const Options& correlatorOptions)
+{
+    // note, restarts the estimate, the window and scratch buffers are preallocated so that correlate() never allocates
+    //
+    std::scoped_lock<std::mutex> lock(mutex);
+    options = correlatorOptions;
+    options.windowSize = std::max<size_t>(options.windowSize, 2);
+    options.minimumSamples = std::clamp<size_t>(options.minimumSamples, 2, options.windowSize);
+    options.updateInterval = std::max<size_t>(options.updateInterval, 1);
+
+    window.reserve(options.windowSize);
+    residuals.reserve(options.windowSize);
+    ordered.reserve(options.windowSize);
+    selected.reserve(options.windowSize);
+    restart();
+}
+
+ClockCorrelator::Options ClockCorrelator::getOptions() const
+{
+    std::scoped_lock<std::mutex> lock(mutex);
+    return options;
+}
+
+bool ClockCorrelator::correlate(FrameMetaData& metaData)
+{
+    // notes 1, called by the handler() for each frame, fills in the frame's host timestamps and transport latency
+    //       2, returns false (and leaves them as 0) until enough samples have been collected, or if the frame has no camera timestamp
+    //
+    if ((metaData.cameraTimestamp == 0) || (metaData.arrivalTime == 0)) return false;
+
+    std::scoped_lock<std::mutex> lock(mutex);
+    if (metaData.cameraTimestamp <= lastCameraTimestamp)
+    {
+        // a repeated timestamp is ignored, a timestamp that has gone backwards means the camera's clock has been reset
+        //
+        if (metaData.cameraTimestamp == lastCameraTimestamp) return false;
+
+        restart();
+        estimate.restarts++;
+    }
+
+    lastCameraTimestamp = metaData.cameraTimestamp;
+
+    const auto sample = Sample{metaData.cameraTimestamp, metaData.arrivalTime};
+    if (window.size() < options.windowSize) window.emplace_back(sample);
+    else window[windowHead] = sample;
+    windowHead = (windowHead + 1) % options.windowSize;
+    estimate.samples++;
+
+    // note, updated for every frame until the 1st estimate, then every updateInterval frames
+    //
+    sinceUpdate++;
+    if ((window.size() >= options.minimumSamples) && (!estimate.valid || (sinceUpdate >= options.updateInterval))) update();
+    if (!estimate.valid) return false;
+
+    const double elapsed = static_cast<double>(static_cast<int64_t>(metaData.cameraTimestamp - referenceCamera));
+    const int64_t hostTimestamp = static_cast<int64_t>(referenceHost) + std::llround(elapsed * (1.0 + skew)) - static_cast<int64_t>(options.fixedLatency);
+
+    metaData.hostTimestamp = hostTimestamp;
+    metaData.hostRealtime = hostTimestamp + realtimeOffset;
+    metaData.transportLatency = static_cast<int64_t>(metaData.arrivalTime) - hostTimestamp;
+
+    return true;
+}
+
+void ClockCorrelator::update()
+{
+    // the samples are relative to the oldest sample in the window, i.e. so that the doubles keep full precision
+    // note, x is the camera time and y the delay, i.e. the arrival time less the camera time
+    //
+    sinceUpdate = 0;
+    const size_t count = window.size();
+    const size_t oldest = (count < options.windowSize) ? 0 : windowHead;
+    const uint64_t cameraBase = window[oldest].cameraTimestamp;
+    const uint64_t arrivalBase = window[oldest].arrivalTime;
+
+    residuals.resize(count);
+    selected.assign(count, 1);
+
+    const auto median = [this]() {
+        ordered.assign(residuals.begin(), residuals.end());
+        const auto middle = ordered.begin() + (ordered.size() / 2);
+        std::nth_element(ordered.begin(), middle, ordered.end());
+
+        return *middle;
+    };
+
+    // fit to every sample, then twice more to only those samples at or below the median residual, i.e. converging on the lower envelope
+    //
+    double intercept = 0.0, slope = 0.0;
+    for (size_t pass = 0; pass < 3; pass++)
+    {
+        if (!fit(cameraBase, arrivalBase, intercept, slope)) return;
+
+        for (size_t i = 0; i < count; i++)
+        {
+            const double x = static_cast<double>(window[i].cameraTimestamp - cameraBase);
+            const double y = static_cast<double>(static_cast<int64_t>(window[i].arrivalTime - arrivalBase)) - x;
+            residuals[i] = y - (intercept + (slope * x));
+        }
+
+        if (pass == 2) break;
+
+        const double threshold = median();
+        for (size_t i = 0; i < count; i++) selected[i] = (residuals[i] <= threshold);
+    }
+
+    // finally, shift the fit down onto the lowest sample, i.e. the sample with the minimum transport delay
+    //
+    const double minimum = *std::min_element(residuals.begin(), residuals.end());
+    intercept += minimum;
+
+    referenceCamera = cameraBase;
+    referenceHost = arrivalBase + std::llround(intercept);
+    skew = slope;
+
+    const auto realtime = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    const auto monotonic = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    realtimeOffset = realtime - monotonic;
+
+    estimate.valid = true;
+    estimate.updates++;
+    estimate.driftPpm = slope * 1000000.0;
+    estimate.offset = static_cast<int64_t>(referenceHost - referenceCamera);
+    estimate.medianExcessDelay = median() - minimum;
+}
+
+bool ClockCorrelator::fit(const uint64_t cameraBase, const uint64_t arrivalBase, double& intercept, double& slope) const
+{
+    // an ordinary least squares fit of the selected samples, centred on their means
+    //
+    double n = 0.0, meanX = 0.0, meanY = 0.0;
+    for (size_t i = 0; i < window.size(); i++)
+    {
+        if (!selected[i]) continue;
+
+        const double x = static_cast<double>(window[i].cameraTimestamp - cameraBase);
+        meanX += x;
+        meanY += static_cast<double>(static_cast<int64_t>(window[i].arrivalTime - arrivalBase)) - x;
+        n += 1.0;
+    }
+
+    if (n < 2.0) return false;
+    meanX /= n;
+    meanY /= n;
+
+    double sxx = 0.0, sxy = 0.0;
+    for (size_t i = 0; i < window.size(); i++)
+    {
+        if (!selected[i]) continue;
+
+        const double x = static_cast<double>(window[i].cameraTimestamp - cameraBase);
+        const double y = static_cast<double>(static_cast<int64_t>(window[i].arrivalTime - arrivalBase)) - x;
+        sxx += (x - meanX) * (x - meanX);
+        sxy += (x - meanX) * (y - meanY);
+    }
+
+    if (sxx <= 0.0) return false;
+
+    slope = sxy / sxx;
+    intercept = meanY - (slope * meanX);
+
+    return true;
+}
+
+ClockCorrelator::Estimate ClockCorrelator::getEstimate() const
+{
+    std::scoped_lock<std::mutex> lock(mutex);
+    return estimate;
+}
+
+void ClockCorrelator::reset()
+{
+    std::scoped_lock<std::mutex> lock(mutex);
+    restart();
+    estimate = Estimate();
+}
+
+void ClockCorrelator::restart()
+{
+    // note, the caller must hold the lock, the counters are kept
+    //
+    window.clear();
+    windowHead = 0;
+    sinceUpdate = 0;
+    lastCameraTimestamp = 0;
+    estimate.valid = false;
+}
@@ -0,0 +1,89 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#ifndef H_CLOCK_CORRELATOR
+#define H_CLOCK_CORRELATOR
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "frame-meta-data.hpp"
+
+// estimates a continuously updated linear mapping from the camera's clock to the host's CLOCK_MONOTONIC (and CLOCK_REALTIME)
+// notes 1, each frame is a sample of (camera timestamp, arrival time), i.e. the arrival time is the exposure time plus a variable transport delay
+//       2, the transport delay (network, driver and queuing) is always positive and its minimum is close to constant, so the mapping is fitted to the lower envelope
+//          i.e. a least squares fit, refitted to only the samples at or below the median residual (rejecting the delayed outliers), and then shifted onto the lowest sample
+//       3, the fit is over a sliding window of samples and is only updated every updateInterval frames, so the cost per frame is a handful of multiplies
+//       4, the host timestamp is therefore the earliest time the frame could have arrived, less the fixed latency (i.e. the known exposure, readout and transfer time)
+//          the transport latency is the arrival time less the host timestamp, so any latency creep (i.e. queuing under load) is seen as an increase
+//       5, the slope gives the camera clock's drift relative to the host, if the camera clock steps backwards (i.e. the camera was reset) the estimate is restarted
+//       6, CLOCK_REALTIME is the host timestamp plus the offset between the two host clocks, sampled at each update so that it follows any NTP adjustment
+//
+class ClockCorrelator
+{
+    public:
+        struct Options
+        {
+            size_t windowSize = 256;
+            size_t minimumSamples = 16;
+            size_t updateInterval = 16;
+            uint64_t fixedLatency = 0;
+        };
+
+        struct Estimate
+        {
+            bool valid = false;
+            uint64_t samples = 0;
+            uint64_t updates = 0;
+            uint64_t restarts = 0;
+            double driftPpm = 0.0;
+            int64_t offset = 0;
+            double medianExcessDelay = 0.0;
+        };
+
+    private:
+        struct Sample
+        {
+            uint64_t cameraTimestamp;
+            uint64_t arrivalTime;
+        };
+
+        Options options;
+        std::vector<Sample> window;
+        size_t windowHead = 0;
+        std::vector<double> residuals;
+        std::vector<double> ordered;
+        std::vector<uint8_t> selected;
+        uint64_t lastCameraTimestamp = 0;
+        size_t sinceUpdate = 0;
+
+        // host = referenceHost + ((camera - referenceCamera) * (1 + skew))
+        //
+        uint64_t referenceCamera = 0;
+        uint64_t referenceHost = 0;
+        double skew = 0.0;
+        int64_t realtimeOffset = 0;
+
+        Estimate estimate;
+        mutable std::mutex mutex;
+
+    public:
+        ClockCorrelator();
+
+        void setOptions(const Options& correlatorOptions);
+        Options getOptions() const;
+
+        bool correlate(FrameMetaData& metaData);
+        Estimate getEstimate() const;
+        void reset();
+
+    private:
+        void restart();
+        void update();
+        bool fit(const uint64_t cameraBase, const uint64_t arrivalBase, double& intercept, double& slope) const;
+};
+
+#endif
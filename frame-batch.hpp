@@ -0,0 +1,44 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#ifndef H_FRAME_BATCH
+#define H_FRAME_BATCH
+
+#include <cstdint>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "frame-meta-data.hpp"
+
+// the consecutive frames captured by a single GigEVideoCapture::grabBatch()
+// notes 1, frames and metaData are in capture order, i.e. metaData[i] belongs to frames[i]
+//       2, missingFrames lists the ranges of camera frame counts that were skipped between consecutive frames of the batch
+//          i.e. frames that the camera sent (or was triggered for) but that never reached the handler()
+//       3, the missing frames can only be detected if the source provides frame counts (i.e. a tcam source), otherwise it is always empty
+//          discontinuities is the number of times the frame count did not advance (i.e. the camera's counter was reset), the frames lost then are unknown
+//       4, cameraFramesDropped is the number of frames the camera itself reported as dropped during the batch
+//       5, the frames are independent of the capture's batch pool, i.e. a later grabBatch() never overwrites them (their buffers may be reused if the batch is reused)
+//
+struct FrameBatch
+{
+    struct MissingFrames
+    {
+        uint64_t first;
+        uint64_t count;
+    };
+
+    std::vector<cv::Mat> frames;
+    std::vector<FrameMetaData> metaData;
+    std::vector<MissingFrames> missingFrames;
+    uint32_t discontinuities = 0;
+    uint64_t cameraFramesDropped = 0;
+
+    bool isComplete() const
+    {
+        return missingFrames.empty() && (discontinuities == 0) && (cameraFramesDropped == 0);
+    }
+};
+
+#endif
@@ -0,0 +1,238 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#include <algorithm>
+#include <memory>
+
+#include <gst/app/gstappsink.h>
+
+#include "capture-telemetry.hpp"
+#include "frame-channel.hpp"
+#include "mapped-sample.hpp"
+#include "zero-copy-allocator.hpp"
+
+FrameChannel::FrameChannel(const std::string& sinkName, GstElement* appSink):
+    name(sinkName), sink(appSink), queue(options.queueDepth)
+{
+    // note, as for the primary appsink, see the GigEVideoCapture constructor
+    //
+    g_object_set(G_OBJECT(sink), "emit-signals", true, "sync", false, nullptr);
+    handlerId = g_signal_connect(sink, "new-sample", G_CALLBACK(FrameChannel::handler), this);
+}
+
+GstFlowReturn FrameChannel::handler(GstElement* sink, gpointer userData)
+{
+    // runs on the branch's own streaming thread, only the sample's reference is queued, i.e. nothing is mapped or copied here
+    // note, the lock is only held to update the queue, the dropped sample (if any) is released after it
+    //
+    FrameChannel& channel = *static_cast<FrameChannel*>(userData);
+    const uint64_t arrivalTime = CaptureTelemetry::now();
+
+    GstSample* sample = gst_app_sink_pull_sample(GST_APP_SINK(sink));
+    if (!sample)
+    {
+        channel.failures++;
+        return GST_FLOW_ERROR;
+    }
+
+    const uint64_t sequence = channel.received++;
+    GstSample* droppedSample = nullptr;
+    {
+        std::scoped_lock<std::mutex> lock(channel.queueMutex);
+        const size_t capacity = channel.queue.size();
+        if (channel.queueCount == capacity)
+        {
+            if (channel.options.dropPolicy == DropPolicy::DROP_NEWEST)
+            {
+                droppedSample = sample;
+            }
+            else
+            {
+                droppedSample = channel.queue[channel.queueHead].sample;
+                channel.queueHead = (channel.queueHead + 1) % capacity;
+                channel.queueCount--;
+            }
+
+            channel.dropped++;
+        }
+
+        if (droppedSample != sample)
+        {
+            channel.queue[(channel.queueHead + channel.queueCount) % capacity] = QueuedSample{sample, arrivalTime, sequence};
+            channel.queueCount++;
+        }
+    }
+
+    if (droppedSample != nullptr) gst_sample_unref(droppedSample);
+    channel.queueCondition.notify_one();
+
+    return GST_FLOW_OK;
+}
+
+const std::string& FrameChannel::getName() const
+{
+    return name;
+}
+
+void FrameChannel::setOptions(const Options& channelOptions)
+{
+    // note, any queued samples are released
+    //
+    std::scoped_lock<std::mutex> lock(queueMutex);
+    options = channelOptions;
+    options.queueDepth = std::max<size_t>(options.queueDepth, 1);
+
+    clear();
+    queue.resize(options.queueDepth);
+}
+
+const FrameChannel::Options& FrameChannel::getOptions() const
+{
+    return options;
+}
+
+bool FrameChannel::grab(cv::Mat& frame)
+{
+    auto queued = QueuedSample();
+    return waitForSample(queued, nullptr) && readFrame(queued, frame);
+}
+
+bool FrameChannel::tryGrab(cv::Mat& frame, const std::chrono::milliseconds timeout)
+{
+    auto queued = QueuedSample();
+    return waitForSample(queued, &timeout) && readFrame(queued, frame);
+}
+
+bool FrameChannel::waitForSample(QueuedSample& queued, const std::chrono::milliseconds* timeout)
+{
+    std::unique_lock<std::mutex> lock(queueMutex);
+    const auto ready = [this] { return queueCount > 0; };
+    if (timeout == nullptr) queueCondition.wait(lock, ready);
+    else if (!queueCondition.wait_for(lock, *timeout, ready)) return false;
+
+    queued = queue[queueHead];
+    queue[queueHead] = QueuedSample();
+    queueHead = (queueHead + 1) % queue.size();
+    queueCount--;
+
+    return true;
+}
+
+bool FrameChannel::readFrame(QueuedSample& queued, cv::Mat& frame)
+{
+    GstBuffer* buffer = gst_sample_get_buffer(queued.sample);
+
+    GstMapInfo info;
+    if (!gst_buffer_map(buffer, &info, GST_MAP_READ))
+    {
+        gst_sample_unref(queued.sample);
+        failures++;
+
+        return false;
+    }
+
+    // from here on the sample is released with the mapping, see MappedSample
+    //
+    const auto mappedSample = std::make_shared<MappedSample>(queued.sample, buffer, info);
+
+    // note, each branch has its own caps (i.e. a scaled branch), only parsed when first negotiated or if they change
+    //
+    GstCaps* caps = gst_sample_get_caps(queued.sample);
+    if (caps != frameCaps)
+    {
+        auto format = FrameFormat();
+        if (!FrameFormat::fromCaps(caps, format))
+        {
+            g_warning("Failed to parse the negotiated caps of appsink: %s, the format is not supported", name.c_str());
+            failures++;
+
+            return false;
+        }
+
+        format.resolveStride(info.size);
+        frameFormat = format;
+
+        if (frameCaps != nullptr) gst_caps_unref(frameCaps);
+        frameCaps = gst_caps_ref(caps);
+    }
+
+    cv::Mat source;
+    if (!mappedSample->view(frameFormat, source))
+    {
+        g_warning("The mapped buffer of appsink: %s is smaller than the negotiated frame size", name.c_str());
+        failures++;
+
+        return false;
+    }
+
+    auto metaData = FrameMetaData();
+    metaData.sequence = queued.sequence;
+    metaData.arrivalTime = queued.arrivalTime;
+    mappedSample->readMetaData(metaData);
+
+    if ((options.conversion != BayerConverter::Output::NONE) && frameFormat.isBayer()) BayerConverter::convert(source, frameFormat.bayerPattern, options.conversion, frame);
+    else if (options.zeroCopy) frame = ZeroCopyAllocator::wrap(source.data, source.rows, source.cols, source.type(), source.step, mappedSample);
+    else source.copyTo(frame);
+
+    frameMetaData = metaData;
+    delivered++;
+
+    return true;
+}
+
+const FrameMetaData& FrameChannel::getFrameMetaData() const
+{
+    // note, returns the meta data of the most recently grabbed frame
+    //
+    return frameMetaData;
+}
+
+const FrameFormat& FrameChannel::getFrameFormat() const
+{
+    // note, the format of the most recently grabbed frame, i.e. invalid until the 1st frame has been grabbed
+    //
+    return frameFormat;
+}
+
+FrameChannel::Statistics FrameChannel::getStatistics()
+{
+    auto statistics = Statistics();
+    statistics.received = received.load();
+    statistics.delivered = delivered.load();
+    statistics.dropped = dropped.load();
+    statistics.failures = failures.load();
+
+    std::scoped_lock<std::mutex> lock(queueMutex);
+    statistics.queued = queueCount;
+
+    return statistics;
+}
+
+void FrameChannel::clear()
+{
+    // note, the caller must hold the queue lock
+    //
+    for (; queueCount > 0; queueCount--)
+    {
+        gst_sample_unref(queue[queueHead].sample);
+        queue[queueHead] = QueuedSample();
+        queueHead = (queueHead + 1) % queue.size();
+    }
+
+    queueHead = 0;
+}
+
+FrameChannel::~FrameChannel()
+{
+    // note, the pipeline should be stopped first, i.e. so that the handler() is not running
+    //
+    g_signal_handler_disconnect(sink, handlerId);
+
+    {
+        std::scoped_lock<std::mutex> lock(queueMutex);
+        clear();
+    }
+
+    if (frameCaps != nullptr) gst_caps_unref(frameCaps);
+}
@@ -0,0 +1,103 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#ifndef H_FRAME_CHANNEL
+#define H_FRAME_CHANNEL
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <gst/gst.h>
+#include <opencv2/opencv.hpp>
+
+#include "bayer-converter.hpp"
+#include "frame-format.hpp"
+#include "frame-meta-data.hpp"
+
+// an independent frame delivery channel for an additional appsink, i.e. a branch of a pipeline that uses a tee
+// notes 1, the channel's handler() only queues the pulled sample, the frame is mapped and copied (or wrapped) when it is grabbed
+//          i.e. the branching, scaling and decimation are all done upstream by the pipeline's own streaming threads
+//       2, the queue holds up to queueDepth samples, when full either the oldest queued sample or the new sample is dropped
+//          each queued sample holds on to a pipeline buffer, so queueDepth must be less than the branch's buffer pool size
+//       3, the frames are delivered in FIFO order, each channel has its own frame format, meta data and statistics
+//       4, zeroCopy and conversion behave as for GigEVideoCapture::GrabMode::ZERO_COPY and setOutputConversion()
+//
+class FrameChannel
+{
+    public:
+        enum class DropPolicy { DROP_OLDEST, DROP_NEWEST };
+
+        struct Options
+        {
+            size_t queueDepth = 2;
+            DropPolicy dropPolicy = DropPolicy::DROP_OLDEST;
+            bool zeroCopy = false;
+            BayerConverter::Output conversion = BayerConverter::Output::NONE;
+        };
+
+        struct Statistics
+        {
+            uint64_t received = 0;
+            uint64_t delivered = 0;
+            uint64_t dropped = 0;
+            uint64_t failures = 0;
+            size_t queued = 0;
+        };
+
+    private:
+        struct QueuedSample
+        {
+            GstSample* sample = nullptr;
+            uint64_t arrivalTime = 0;
+            uint64_t sequence = 0;
+        };
+
+        const std::string name;
+        GstElement* sink;
+        gulong handlerId = 0;
+        Options options;
+
+        std::vector<QueuedSample> queue;
+        size_t queueHead = 0;
+        size_t queueCount = 0;
+        std::mutex queueMutex;
+        std::condition_variable queueCondition;
+
+        FrameFormat frameFormat;
+        GstCaps* frameCaps = nullptr;
+        FrameMetaData frameMetaData;
+
+        std::atomic<uint64_t> received = 0;
+        std::atomic<uint64_t> delivered = 0;
+        std::atomic<uint64_t> dropped = 0;
+        std::atomic<uint64_t> failures = 0;
+
+    public:
+        FrameChannel(const std::string& sinkName, GstElement* appSink);
+
+        const std::string& getName() const;
+        void setOptions(const Options& channelOptions);
+        const Options& getOptions() const;
+
+        bool grab(cv::Mat& frame);
+        bool tryGrab(cv::Mat& frame, const std::chrono::milliseconds timeout);
+        const FrameMetaData& getFrameMetaData() const;
+        const FrameFormat& getFrameFormat() const;
+        Statistics getStatistics();
+
+        ~FrameChannel();
+
+    private:
+        bool waitForSample(QueuedSample& queued, const std::chrono::milliseconds* timeout);
+        bool readFrame(QueuedSample& queued, cv::Mat& frame);
+        void clear();
+        static GstFlowReturn handler(GstElement* sink, gpointer userData);
+};
+
+#endif
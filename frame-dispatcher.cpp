@@ -0,0 +1,238 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#include <exception>
+#include <string>
+
+#include <glib.h>
+
+#include "frame-dispatcher.hpp"
+
+FrameDispatcher::FrameDispatcher(const size_t workerCount)
+{
+    const size_t count = (workerCount == 0) ? 1 : workerCount;
+    for (size_t i = 0; i < count; i++) workers.emplace_back(&FrameDispatcher::worker, this);
+}
+
+uint64_t FrameDispatcher::subscribe(FrameCallback callback, const Options& options)
+{
+    std::scoped_lock<std::mutex> lock(lockMutex);
+
+    auto& subscription = subscriptions.emplace_back();
+    subscription.id = nextId++;
+    subscription.callback = std::move(callback);
+    subscription.options = options;
+    if (subscription.options.maxInFlight == 0) subscription.options.maxInFlight = 1;
+    subscriberCount++;
+
+    return subscription.id;
+}
+
+bool FrameDispatcher::unsubscribe(const uint64_t id)
+{
+    std::unique_lock<std::mutex> lock(lockMutex);
+    for (auto subscription = subscriptions.begin(); subscription != subscriptions.end(); subscription++)
+    {
+        if (subscription->id != id) continue;
+
+        // notes 1, discard any queued frames and then wait for the running callbacks to return
+        //       2, also wait for any blocked publish() to give up on the subscription, it may still be referencing it
+        //
+        subscription->active = false;
+        subscription->queue.clear();
+        spaceAvailable.notify_all();
+        jobFinished.wait(lock, [this, &subscription] { return (subscription->running == 0) && (publishing == 0); });
+
+        subscriptions.erase(subscription);
+        subscriberCount--;
+        return true;
+    }
+
+    return false;
+}
+
+bool FrameDispatcher::hasSubscribers() const
+{
+    // note, lock free as this is checked by the handler() for every frame
+    //
+    return subscriberCount.load() > 0;
+}
+
+void FrameDispatcher::publish(const cv::Mat& frame, const std::vector<cv::Mat>& views, const FrameMetaData& metaData, Preparation preparation)
+{
+    // notes 1, views[i] is the frame's i'th view, a subscription for a view that the frame does not have is given the whole frame
+    //       2, the preparation (if any) may replace the frame and its views, see worker()
+    //
+    auto published = std::make_shared<Published>();
+    published->frame = frame;
+    published->views = views;
+    published->metaData = metaData;
+    published->preparation = std::move(preparation);
+
+    std::unique_lock<std::mutex> lock(lockMutex);
+    publishing++;
+
+    for (auto& subscription : subscriptions)
+    {
+        if (!subscription.active) continue;
+
+        bool accepted = true;
+        while (inFlight(subscription) >= subscription.options.maxInFlight)
+        {
+            if (subscription.options.backpressure == Backpressure::BLOCK)
+            {
+                spaceAvailable.wait(lock);
+                if (stopping || !subscription.active)
+                {
+                    accepted = false;
+                    break;
+                }
+            }
+            else if ((subscription.options.backpressure == Backpressure::DROP_OLDEST) && !subscription.queue.empty())
+            {
+                subscription.queue.pop_front();
+                subscription.statistics.dropped++;
+            }
+            else
+            {
+                // note, DROP_OLDEST also ends up here if all of the in flight frames are already running
+                //
+                subscription.statistics.dropped++;
+                accepted = false;
+                break;
+            }
+        }
+
+        if (!accepted) continue;
+
+        subscription.queue.push_back(Job{published});
+    }
+
+    publishing--;
+    lock.unlock();
+
+    jobFinished.notify_all();
+    workAvailable.notify_all();
+}
+
+bool FrameDispatcher::getStatistics(const uint64_t id, Statistics& statistics)
+{
+    std::scoped_lock<std::mutex> lock(lockMutex);
+    for (const auto& subscription : subscriptions)
+    {
+        if (subscription.id != id) continue;
+
+        statistics = subscription.statistics;
+        statistics.inFlight = inFlight(subscription);
+        return true;
+    }
+
+    return false;
+}
+
+void FrameDispatcher::worker()
+{
+    std::unique_lock<std::mutex> lock(lockMutex);
+    while (true)
+    {
+        Subscription* subscription = nullptr;
+        workAvailable.wait(lock, [this, &subscription] { return stopping || ((subscription = nextRunnable()) != nullptr); });
+        if (stopping) return;
+
+        auto job = std::move(subscription->queue.front());
+        subscription->queue.pop_front();
+        subscription->running++;
+        lock.unlock();
+
+        // note, if the preparation throws it is retried by the next worker to deliver the frame
+        //
+        try
+        {
+            Published& published = *job.published;
+            std::call_once(published.prepared, [&published] { if (published.preparation) published.preparation(published.frame, published.views); });
+
+            const int32_t view = subscription->options.view;
+            const bool viewed = (view >= 0) && (static_cast<size_t>(view) < published.views.size()) && !published.views[view].empty();
+            subscription->callback(viewed ? published.views[view] : published.frame, published.metaData);
+        }
+        catch (const std::exception& exception)
+        {
+            g_warning("FrameDispatcher callback failed, reason: %s", exception.what());
+        }
+        catch (const std::string& exception)
+        {
+            g_warning("FrameDispatcher callback failed, reason: %s", exception.c_str());
+        }
+
+        // note, release the frame before re-acquiring the lock, it may be the last reference to a gstreamer buffer
+        //
+        job.published.reset();
+
+        lock.lock();
+        subscription->running--;
+        subscription->statistics.delivered++;
+        spaceAvailable.notify_all();
+        jobFinished.notify_all();
+    }
+}
+
+FrameDispatcher::Subscription* FrameDispatcher::nextRunnable()
+{
+    // round robin between the subscriptions, so that a busy subscription can't starve the others
+    //
+    const size_t count = subscriptions.size();
+    if (count == 0) return nullptr;
+
+    auto subscription = subscriptions.begin();
+    std::advance(subscription, nextSubscription % count);
+    for (size_t i = 0; i < count; i++)
+    {
+        if (isRunnable(*subscription))
+        {
+            nextSubscription = (nextSubscription + i + 1) % count;
+            return &(*subscription);
+        }
+
+        if (++subscription == subscriptions.end()) subscription = subscriptions.begin();
+    }
+
+    return nullptr;
+}
+
+bool FrameDispatcher::isRunnable(const Subscription& subscription)
+{
+    // note, an ORDERED subscription only ever has one running callback
+    //
+    if (!subscription.active || subscription.queue.empty()) return false;
+    return (subscription.options.delivery == Delivery::UNORDERED) || (subscription.running == 0);
+}
+
+size_t FrameDispatcher::inFlight(const Subscription& subscription)
+{
+    return subscription.queue.size() + subscription.running;
+}
+
+std::vector<std::thread::native_handle_type> FrameDispatcher::getWorkerHandles()
+{
+    // note, i.e. so that the workers can be scheduled, see GigEVideoCapture::setThreadScheduling()
+    //
+    auto handles = std::vector<std::thread::native_handle_type>();
+    for (auto& worker : workers) handles.emplace_back(worker.native_handle());
+
+    return handles;
+}
+
+FrameDispatcher::~FrameDispatcher()
+{
+    // note, any queued frames are discarded, the running callbacks are allowed to complete
+    //
+    {
+        std::scoped_lock<std::mutex> lock(lockMutex);
+        stopping = true;
+    }
+
+    workAvailable.notify_all();
+    spaceAvailable.notify_all();
+    for (auto& worker : workers) worker.join();
+}
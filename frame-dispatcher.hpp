@@ -0,0 +1,118 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#ifndef H_FRAME_DISPATCHER
+#define H_FRAME_DISPATCHER
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "frame-meta-data.hpp"
+
+// dispatches each published frame to the subscribed callbacks using a bounded pool of worker threads
+// notes 1, ORDERED, the frames are delivered to the callback one at a time and in sequence, i.e. the callback is never invoked concurrently
+//          UNORDERED, the callback is invoked concurrently by as many workers as are available, up to the in flight limit
+//       2, a frame is in flight from when it is published until its callback returns, when the limit is reached the backpressure applies
+//          DROP_OLDEST, the oldest queued (not yet running) frame is discarded
+//          DROP_NEWEST, the published frame is discarded
+//          BLOCK, the publisher (i.e. the gstreamer streaming thread) waits until a frame is no longer in flight
+//       3, the frames are shared with the callbacks, so they should be treated as read only
+//       4, a subscription can be given one of the frame's views (i.e. a region or pyramid level) rather than the whole frame, see GigEVideoCapture::subscribe()
+//       5, a frame can be published with a preparation (i.e. a bayer conversion), this is run once per frame by the 1st worker to deliver it
+//          i.e. off the publishing thread, and the prepared frame (and its views) are then shared by every subscription
+//
+class FrameDispatcher
+{
+    public:
+        using FrameCallback = std::function<void(const cv::Mat& frame, const FrameMetaData& metaData)>;
+        using Preparation = std::function<void(cv::Mat& frame, std::vector<cv::Mat>& views)>;
+
+        enum class Delivery { ORDERED, UNORDERED };
+        enum class Backpressure { DROP_OLDEST, DROP_NEWEST, BLOCK };
+
+        struct Options
+        {
+            Delivery delivery = Delivery::ORDERED;
+            size_t maxInFlight = 4;
+            Backpressure backpressure = Backpressure::DROP_OLDEST;
+            int32_t view = -1;
+        };
+
+        struct Statistics
+        {
+            uint64_t delivered = 0;
+            uint64_t dropped = 0;
+            size_t inFlight = 0;
+        };
+
+    private:
+        // a published frame, shared by the jobs of every subscription it was queued for
+        //
+        struct Published
+        {
+            cv::Mat frame;
+            std::vector<cv::Mat> views;
+            FrameMetaData metaData;
+            Preparation preparation;
+            std::once_flag prepared;
+        };
+
+        struct Job
+        {
+            std::shared_ptr<Published> published;
+        };
+
+        struct Subscription
+        {
+            uint64_t id;
+            FrameCallback callback;
+            Options options;
+            std::deque<Job> queue;
+            size_t running = 0;
+            bool active = true;
+            Statistics statistics;
+        };
+
+        std::list<Subscription> subscriptions;
+        std::vector<std::thread> workers;
+        uint64_t nextId = 1;
+        size_t nextSubscription = 0;
+        size_t publishing = 0;
+        bool stopping = false;
+        std::atomic<size_t> subscriberCount = 0;
+        std::mutex lockMutex;
+        std::condition_variable workAvailable;
+        std::condition_variable spaceAvailable;
+        std::condition_variable jobFinished;
+
+    public:
+        FrameDispatcher(const size_t workerCount);
+
+        uint64_t subscribe(FrameCallback callback, const Options& options);
+        bool unsubscribe(const uint64_t id);
+        bool hasSubscribers() const;
+        void publish(const cv::Mat& frame, const std::vector<cv::Mat>& views, const FrameMetaData& metaData, Preparation preparation = nullptr);
+        bool getStatistics(const uint64_t id, Statistics& statistics);
+        std::vector<std::thread::native_handle_type> getWorkerHandles();
+
+        ~FrameDispatcher();
+
+    private:
+        void worker();
+        Subscription* nextRunnable();
+        static bool isRunnable(const Subscription& subscription);
+        static size_t inFlight(const Subscription& subscription);
+};
+
+#endif
@@ -0,0 +1,140 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#include <gst/video/video.h>
+#include <opencv2/opencv.hpp>
+
+#include "frame-format.hpp"
+
+bool FrameFormat::fromCaps(const GstCaps* caps, FrameFormat& frameFormat)
+{
+    if ((caps == nullptr) || (gst_caps_get_size(caps) == 0)) return false;
+
+    auto parsed = FrameFormat();
+    const GstStructure* structure = gst_caps_get_structure(caps, 0);
+
+    gint fpsN = 0, fpsD = 1;
+    if (gst_structure_get_fraction(structure, "framerate", &fpsN, &fpsD) && (fpsD != 0)) parsed.frameRate = double(fpsN) / double(fpsD);
+
+    if (gst_structure_has_name(structure, "video/x-raw"))
+    {
+        GstVideoInfo videoInfo;
+        if (!gst_video_info_from_caps(&videoInfo, caps)) return false;
+
+        int32_t depth = CV_8U, channels = 0;
+        switch (GST_VIDEO_INFO_FORMAT(&videoInfo))
+        {
+            case GST_VIDEO_FORMAT_GRAY8:
+                channels = 1;
+                break;
+
+            case GST_VIDEO_FORMAT_GRAY16_LE:
+                depth = CV_16U;
+                channels = 1;
+                break;
+
+            case GST_VIDEO_FORMAT_RGB:
+            case GST_VIDEO_FORMAT_BGR:
+                channels = 3;
+                break;
+
+            case GST_VIDEO_FORMAT_RGBx:
+            case GST_VIDEO_FORMAT_BGRx:
+            case GST_VIDEO_FORMAT_xRGB:
+            case GST_VIDEO_FORMAT_xBGR:
+            case GST_VIDEO_FORMAT_RGBA:
+            case GST_VIDEO_FORMAT_BGRA:
+            case GST_VIDEO_FORMAT_ARGB:
+            case GST_VIDEO_FORMAT_ABGR:
+                channels = 4;
+                break;
+
+            // note, anything else (i.e. big endian or planar formats) can't be represented by a single cv::Mat without conversion
+            //
+            default:
+                return false;
+        }
+
+        parsed.format = gst_video_format_to_string(GST_VIDEO_INFO_FORMAT(&videoInfo));
+        parsed.width = GST_VIDEO_INFO_WIDTH(&videoInfo);
+        parsed.height = GST_VIDEO_INFO_HEIGHT(&videoInfo);
+        parsed.type = CV_MAKETYPE(depth, channels);
+        parsed.bitDepth = (depth == CV_16U) ? 16 : 8;
+        parsed.rowBytes = size_t(parsed.width) * (depth == CV_16U ? 2 : 1) * channels;
+        parsed.stride = GST_VIDEO_INFO_PLANE_STRIDE(&videoInfo, 0);
+        parsed.offset = GST_VIDEO_INFO_PLANE_OFFSET(&videoInfo, 0);
+    }
+    else if (gst_structure_has_name(structure, "video/x-bayer"))
+    {
+        // notes 1, gst_video_info_from_caps() treats bayer as an encoded format, i.e. it does not provide the stride
+        //       2, the format is the pattern followed by an optional bit depth, i.e. gbrg, gbrg10, gbrg12, gbrg16 or gbrg16le
+        //       3, the packed formats (i.e. gbrg12p) and big endian formats are not supported
+        //
+        const gchar* format = gst_structure_get_string(structure, "format");
+        if ((format == nullptr) || !gst_structure_get_int(structure, "width", &parsed.width) || !gst_structure_get_int(structure, "height", &parsed.height)) return false;
+
+        const auto name = std::string(format);
+        if (name.size() < 4) return false;
+
+        const auto pattern = name.substr(0, 4);
+        if (pattern == "gbrg") parsed.bayerPattern = BayerPattern::GBRG;
+        else if (pattern == "rggb") parsed.bayerPattern = BayerPattern::RGGB;
+        else if (pattern == "grbg") parsed.bayerPattern = BayerPattern::GRBG;
+        else if (pattern == "bggr") parsed.bayerPattern = BayerPattern::BGGR;
+        else return false;
+
+        auto suffix = name.substr(4);
+        if ((suffix.size() > 2) && (suffix.compare(suffix.size() - 2, 2, "le") == 0)) suffix.resize(suffix.size() - 2);
+
+        if (suffix.empty()) parsed.bitDepth = 8;
+        else if ((suffix == "10") || (suffix == "12") || (suffix == "14") || (suffix == "16")) parsed.bitDepth = std::stoi(suffix);
+        else return false;
+
+        parsed.format = name;
+        parsed.type = (parsed.bitDepth == 8) ? CV_8UC1 : CV_16UC1;
+        parsed.rowBytes = size_t(parsed.width) * (parsed.bitDepth == 8 ? 1 : 2);
+        parsed.stride = parsed.rowBytes;
+    }
+    else
+    {
+        return false;
+    }
+
+    if ((parsed.width <= 0) || (parsed.height <= 0)) return false;
+
+    gchar* capsString = gst_caps_to_string(caps);
+    parsed.caps = capsString;
+    g_free(capsString);
+
+    frameFormat = parsed;
+    return true;
+}
+
+bool FrameFormat::isValid() const
+{
+    return type >= 0;
+}
+
+bool FrameFormat::isBayer() const
+{
+    return bayerPattern != BayerPattern::NONE;
+}
+
+size_t FrameFormat::minimumBufferSize() const
+{
+    // note, the last row does not need to include any padding
+    //
+    return offset + (stride * (height - 1)) + rowBytes;
+}
+
+void FrameFormat::resolveStride(const size_t bufferSize)
+{
+    // bayer caps do not describe any row padding, if present it will be the gstreamer default of rounding up to 4 bytes
+    // note, this is only called when the caps change, using the size of the 1st buffer received
+    //
+    if (!isBayer()) return;
+
+    const size_t padded = (rowBytes + 3) & ~size_t(3);
+    stride = (bufferSize >= (padded * height)) ? padded : rowBytes;
+}
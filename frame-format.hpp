@@ -0,0 +1,45 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#ifndef H_FRAME_FORMAT
+#define H_FRAME_FORMAT
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <gst/gst.h>
+
+// the frame geometry and cv::Mat type, parsed from the negotiated caps
+// notes 1, supports video/x-raw GRAY8, GRAY16_LE, RGB, BGR and the 4 byte RGBx variants
+//       2, supports video/x-bayer 8 bit (i.e. gbrg) and the unpacked 10, 12 and 16 bit variants (i.e. gbrg10, gbrg12, gbrg16)
+//          these are held in a 16 bit little endian container, bitDepth gives the number of significant bits
+//       3, the stride is the number of bytes between the start of each row, it will be larger than rowBytes if the rows are padded
+//       4, caps is the string form of the negotiated caps, i.e. it can be stored and parsed again later using gst_caps_from_string()
+//
+struct FrameFormat
+{
+    enum class BayerPattern { NONE, GBRG, RGGB, GRBG, BGGR };
+
+    std::string format;
+    std::string caps;
+    int32_t width = 0;
+    int32_t height = 0;
+    int32_t type = -1;
+    int32_t bitDepth = 0;
+    size_t rowBytes = 0;
+    size_t stride = 0;
+    size_t offset = 0;
+    double frameRate = 0.0;
+    BayerPattern bayerPattern = BayerPattern::NONE;
+
+    static bool fromCaps(const GstCaps* caps, FrameFormat& frameFormat);
+
+    bool isValid() const;
+    bool isBayer() const;
+    size_t minimumBufferSize() const;
+    void resolveStride(const size_t bufferSize);
+};
+
+#endif
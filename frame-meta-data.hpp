@@ -0,0 +1,42 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#ifndef H_FRAME_META_DATA
+#define H_FRAME_META_DATA
+
+#include <cstdint>
+#include <memory>
+
+struct FrameStatistics;
+
+// the per frame meta data, captured by the handler() at the same time as the frame
+// notes 1, the camera values are extracted from the TcamStatisticsMeta
+//       2, if the pipeline source does not provide it (i.e. videotestsrc) the camera timestamp is the buffer's presentation timestamp and the other camera values are zero
+//       3, the arrival time is when the handler() received the frame, CLOCK_MONOTONIC in nanoseconds
+//       4, the settings generation is that of the last property transaction applied before the frame was captured, see GigEVideoCapture::commitProperties()
+//       5, the host timestamps are the camera timestamp mapped to CLOCK_MONOTONIC and CLOCK_REALTIME (in nanoseconds), and the transport latency is the arrival time less
+//          the host timestamp, see ClockCorrelator, they are zero until the clock correlation has been established
+//       6, the statistics are null unless enabled, see GigEVideoCapture::setFrameStatistics(), they are computed as the frame is delivered
+//          they are held out of line (and shared by every copy of the meta data), i.e. so that the meta data stays small, see frame-statistics.hpp
+//       7, changed is false if the frame was gated as unchanged (and flagged rather than suppressed), the change score is 0 unless the change detection is enabled
+//          see GigEVideoCapture::setChangeDetection()
+//
+struct FrameMetaData
+{
+    uint64_t sequence = 0;
+    uint64_t arrivalTime = 0;
+    uint64_t cameraTimestamp = 0;
+    uint64_t cameraFrameCount = 0;
+    uint64_t cameraFramesDropped = 0;
+    double cameraFrameRate = 0.0;
+    uint64_t settingsGeneration = 0;
+    uint64_t hostTimestamp = 0;
+    uint64_t hostRealtime = 0;
+    int64_t transportLatency = 0;
+    std::shared_ptr<const FrameStatistics> statistics;
+    bool changed = true;
+    double changeScore = 0.0;
+};
+
+#endif
@@ -0,0 +1,282 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "frame-recorder.hpp"
+
+FrameRecorder::FrameRecorder(const std::string& path, const FrameFormat& format, const Options& recorderOptions):
+    frameFormat(format), options(recorderOptions), freeChunks(std::max<size_t>(recorderOptions.chunkBuffers, 2)), fullChunks(std::max<size_t>(recorderOptions.chunkBuffers, 2))
+{
+    if (!frameFormat.isValid()) throw std::string("Unable to record, the frame format is not known");
+    if (options.framesPerChunk == 0) throw std::string("Unable to record, framesPerChunk must be at least 1");
+
+    const int32_t flags = O_WRONLY | O_CREAT | O_TRUNC;
+    if (options.directIo) fd = open(path.c_str(), flags | O_DIRECT, 0644);
+    if (fd < 0) fd = open(path.c_str(), flags, 0644);
+    if (fd < 0) throw std::string("Unable to create the recording: ") + path + ", reason: " + strerror(errno);
+
+    // notes 1, the frames are recorded without any row padding
+    //       2, the chunk header holds the index entries for the chunk's frames, see recording-format.hpp
+    //
+    frameBytes = frameFormat.rowBytes * frameFormat.height;
+    chunkHeaderBytes = recordingBlocks(sizeof(RecordingChunkHeader) + (options.framesPerChunk * sizeof(RecordingIndexEntry)));
+    chunkBytes = recordingBlocks(chunkHeaderBytes + (options.framesPerChunk * frameBytes));
+
+    // preallocate (and touch) every chunk buffer, so that the handler() never allocates or page faults
+    // note, block aligned as required by O_DIRECT
+    //
+    for (size_t i = 0; i < freeChunks.capacity(); i++)
+    {
+        void* chunk = nullptr;
+        if (posix_memalign(&chunk, RECORDING_BLOCK_SIZE, chunkBytes) != 0)
+        {
+            for (auto allocated : chunks) free(allocated);
+            ::close(fd);
+            throw std::string("Unable to allocate the recording chunk buffers");
+        }
+
+        memset(chunk, 0, chunkBytes);
+        chunks.emplace_back(static_cast<uint8_t*>(chunk));
+
+        *freeChunks.acquireWrite() = i;
+        freeChunks.commitWrite();
+    }
+
+    writeHeader(0, 0);
+    writerThread = std::thread(&FrameRecorder::writer, this);
+}
+
+bool FrameRecorder::record(const cv::Mat& frame, const FrameMetaData& metaData)
+{
+    // note, the frame must match the format that the recording was started with, i.e. the caps have not changed
+    //
+    if (closed.load() || (frame.rows != frameFormat.height) || (frame.cols != frameFormat.width) || (frame.type() != frameFormat.type))
+    {
+        dropped++;
+        return false;
+    }
+
+    if (!hasCurrentChunk)
+    {
+        const size_t* freeChunk = freeChunks.acquireRead();
+        if (freeChunk == nullptr)
+        {
+            // the writer has fallen behind, i.e. every chunk buffer is full and waiting to be written
+            //
+            dropped++;
+            return false;
+        }
+
+        currentChunk = *freeChunk;
+        freeChunks.commitRead();
+        hasCurrentChunk = true;
+        currentFrames = 0;
+        currentOpened = metaData.arrivalTime;
+
+        auto* header = reinterpret_cast<RecordingChunkHeader*>(chunks[currentChunk]);
+        memcpy(header->magic, RECORDING_CHUNK_MAGIC, sizeof(header->magic));
+        header->frameCount = 0;
+        header->chunkIndex = nextChunkIndex++;
+    }
+
+    uint8_t* chunk = chunks[currentChunk];
+    auto* header = reinterpret_cast<RecordingChunkHeader*>(chunk);
+    auto* entries = reinterpret_cast<RecordingIndexEntry*>(chunk + sizeof(RecordingChunkHeader));
+    const size_t frameOffset = chunkHeaderBytes + (currentFrames * frameBytes);
+
+    entries[currentFrames].offset = RECORDING_BLOCK_SIZE + (header->chunkIndex * chunkBytes) + frameOffset;
+    entries[currentFrames].cameraTimestamp = metaData.cameraTimestamp;
+    entries[currentFrames].sequence = metaData.sequence;
+    entries[currentFrames].cameraFrameCount = metaData.cameraFrameCount;
+
+    // note, copyTo() removes any row padding, the destination is a cv::Mat header for the chunk buffer so nothing is allocated
+    //
+    auto destination = cv::Mat(frameFormat.height, frameFormat.width, frameFormat.type, chunk + frameOffset);
+    frame.copyTo(destination);
+
+    header->frameCount = ++currentFrames;
+    recorded++;
+
+    // note, the flush is checked as each frame arrives, i.e. a partial chunk is published with the 1st frame after the interval (it is not timer driven)
+    //
+    const uint64_t flushInterval = std::chrono::duration_cast<std::chrono::nanoseconds>(options.flushInterval).count();
+    const bool expired = (flushInterval != 0) && ((metaData.arrivalTime - currentOpened) >= flushInterval);
+    if ((currentFrames == options.framesPerChunk) || expired) publishCurrentChunk();
+
+    return true;
+}
+
+void FrameRecorder::publishCurrentChunk()
+{
+    // note, the full ring can never overflow as it has a slot for every chunk buffer
+    //
+    *fullChunks.acquireWrite() = currentChunk;
+    fullChunks.commitWrite();
+    hasCurrentChunk = false;
+
+    writerCondition.notify_one();
+}
+
+FrameRecorder::Statistics FrameRecorder::getStatistics() const
+{
+    auto statistics = Statistics();
+    statistics.recorded = recorded.load();
+    statistics.dropped = dropped.load();
+    statistics.chunksWritten = chunksWritten.load();
+    statistics.bytesWritten = bytesWritten.load();
+    statistics.writeErrors = writeErrors.load();
+
+    return statistics;
+}
+
+void FrameRecorder::writer()
+{
+    while (true)
+    {
+        // note, closing must be read before checking the ring, so that the last chunk published by close() is not missed
+        //
+        const bool finishing = closing.load();
+        const size_t* fullChunk = fullChunks.acquireRead();
+        if (fullChunk == nullptr)
+        {
+            if (finishing) break;
+
+            // notes 1, the handler() notifies without taking the lock, so the timeout bounds any missed notification
+            //       2, this only adds latency to the writes, it never blocks the handler()
+            //
+            std::unique_lock<std::mutex> lock(writerMutex);
+            writerCondition.wait_for(lock, std::chrono::milliseconds(10));
+            continue;
+        }
+
+        const size_t chunk = *fullChunk;
+        fullChunks.commitRead();
+        writeChunk(chunk);
+
+        *freeChunks.acquireWrite() = chunk;
+        freeChunks.commitWrite();
+    }
+}
+
+bool FrameRecorder::writeChunk(const size_t chunk)
+{
+    const auto* header = reinterpret_cast<const RecordingChunkHeader*>(chunks[chunk]);
+    const auto* entries = reinterpret_cast<const RecordingIndexEntry*>(chunks[chunk] + sizeof(RecordingChunkHeader));
+
+    // note, the chunk is always written at its full size, i.e. a partially filled chunk is padded
+    //
+    if (!writeBlocks(chunks[chunk], chunkBytes, RECORDING_BLOCK_SIZE + (header->chunkIndex * chunkBytes))) return false;
+
+    index.insert(index.end(), entries, entries + header->frameCount);
+    chunksWritten++;
+
+    return true;
+}
+
+bool FrameRecorder::writeBlocks(const void* data, const size_t bytes, const uint64_t offset)
+{
+    size_t written = 0;
+    while (written < bytes)
+    {
+        const ssize_t result = pwrite(fd, static_cast<const uint8_t*>(data) + written, bytes - written, offset + written);
+        if (result < 0)
+        {
+            if (errno == EINTR) continue;
+
+            // the file system may reject O_DIRECT writes, if so fall back to buffered writes
+            //
+            const int32_t flags = fcntl(fd, F_GETFL);
+            if ((errno == EINVAL) && (flags & O_DIRECT) && (fcntl(fd, F_SETFL, flags & ~O_DIRECT) == 0)) continue;
+
+            writeErrors++;
+            return false;
+        }
+
+        written += result;
+    }
+
+    bytesWritten += bytes;
+    return true;
+}
+
+void FrameRecorder::writeHeader(const uint64_t indexOffset, const uint64_t frameCount)
+{
+    void* block = nullptr;
+    if (posix_memalign(&block, RECORDING_BLOCK_SIZE, RECORDING_BLOCK_SIZE) != 0)
+    {
+        writeErrors++;
+        return;
+    }
+
+    memset(block, 0, RECORDING_BLOCK_SIZE);
+    auto* header = static_cast<RecordingHeader*>(block);
+    memcpy(header->magic, RECORDING_MAGIC, sizeof(header->magic));
+    header->version = RECORDING_VERSION;
+    header->headerBytes = RECORDING_BLOCK_SIZE;
+    header->width = frameFormat.width;
+    header->height = frameFormat.height;
+    header->type = frameFormat.type;
+    header->bitDepth = frameFormat.bitDepth;
+    header->rowBytes = frameFormat.rowBytes;
+    header->frameBytes = frameBytes;
+    header->framesPerChunk = options.framesPerChunk;
+    header->chunkHeaderBytes = chunkHeaderBytes;
+    header->chunkBytes = chunkBytes;
+    header->frameRate = frameFormat.frameRate;
+    header->indexOffset = indexOffset;
+    header->frameCount = frameCount;
+    strncpy(header->format, frameFormat.format.c_str(), sizeof(header->format) - 1);
+    strncpy(header->caps, frameFormat.caps.c_str(), sizeof(header->caps) - 1);
+
+    writeBlocks(block, RECORDING_BLOCK_SIZE, 0);
+    free(block);
+}
+
+void FrameRecorder::close()
+{
+    // note, must not be called while record() is in progress, i.e. the caller must first stop the handler() from recording
+    //
+    if (closed.exchange(true)) return;
+
+    if (hasCurrentChunk && (currentFrames > 0)) publishCurrentChunk();
+    closing.store(true);
+    writerCondition.notify_one();
+    writerThread.join();
+
+    // finally, append the index and update the header so that it refers to it
+    //
+    const uint64_t indexOffset = RECORDING_BLOCK_SIZE + (nextChunkIndex * chunkBytes);
+    const size_t indexBytes = recordingBlocks(sizeof(RecordingIndexHeader) + (index.size() * sizeof(RecordingIndexEntry)));
+
+    void* block = nullptr;
+    if (posix_memalign(&block, RECORDING_BLOCK_SIZE, indexBytes) == 0)
+    {
+        memset(block, 0, indexBytes);
+        auto* indexHeader = static_cast<RecordingIndexHeader*>(block);
+        memcpy(indexHeader->magic, RECORDING_INDEX_MAGIC, sizeof(indexHeader->magic));
+        indexHeader->frameCount = index.size();
+        if (!index.empty()) memcpy(static_cast<uint8_t*>(block) + sizeof(RecordingIndexHeader), index.data(), index.size() * sizeof(RecordingIndexEntry));
+
+        if (writeBlocks(block, indexBytes, indexOffset)) writeHeader(indexOffset, index.size());
+        free(block);
+    }
+
+    fdatasync(fd);
+    ::close(fd);
+
+    for (auto chunk : chunks) free(chunk);
+    chunks.clear();
+}
+
+FrameRecorder::~FrameRecorder()
+{
+    close();
+}
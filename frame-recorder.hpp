@@ -0,0 +1,98 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#ifndef H_FRAME_RECORDER
+#define H_FRAME_RECORDER
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "frame-format.hpp"
+#include "frame-meta-data.hpp"
+#include "recording-format.hpp"
+#include "spsc-ring.hpp"
+
+// records raw frames and their camera timestamps to disk, see recording-format.hpp
+// notes 1, record() is called by the handler(), it copies the frame into a preallocated chunk buffer and never blocks
+//          if every chunk buffer is waiting to be written (i.e. the disk has fallen behind) the frame is dropped and counted
+//       2, the full chunk buffers are written by a dedicated writer thread using large, block aligned, sequential writes
+//       3, the chunk buffers are passed between the two threads using a pair of lock free rings (i.e. free and full)
+//       4, optionally uses O_DIRECT to bypass the page cache, if not supported by the file system it falls back to buffered writes
+//       5, a chunk is published when full or once its 1st frame is older than flushInterval (i.e. at a low frame rate), 0 only publishes full chunks
+//          a crash loses the frames not yet written, i.e. the chunk being filled and any chunks waiting for the writer (at most chunkBuffers)
+//
+class FrameRecorder
+{
+    public:
+        struct Options
+        {
+            uint32_t framesPerChunk = 16;
+            size_t chunkBuffers = 8;
+            bool directIo = false;
+            std::chrono::milliseconds flushInterval = std::chrono::milliseconds(1000);
+        };
+
+        struct Statistics
+        {
+            uint64_t recorded = 0;
+            uint64_t dropped = 0;
+            uint64_t chunksWritten = 0;
+            uint64_t bytesWritten = 0;
+            uint64_t writeErrors = 0;
+        };
+
+    private:
+        const FrameFormat frameFormat;
+        const Options options;
+        int32_t fd = -1;
+        size_t frameBytes, chunkHeaderBytes, chunkBytes;
+
+        std::vector<uint8_t*> chunks;
+        SpscRing<size_t> freeChunks;
+        SpscRing<size_t> fullChunks;
+        size_t currentChunk = 0;
+        uint32_t currentFrames = 0;
+        uint64_t currentOpened = 0;
+        bool hasCurrentChunk = false;
+        uint64_t nextChunkIndex = 0;
+
+        std::vector<RecordingIndexEntry> index;
+        std::thread writerThread;
+        std::mutex writerMutex;
+        std::condition_variable writerCondition;
+        std::atomic<bool> closing = false;
+        std::atomic<bool> closed = false;
+
+        std::atomic<uint64_t> recorded = 0;
+        std::atomic<uint64_t> dropped = 0;
+        std::atomic<uint64_t> chunksWritten = 0;
+        std::atomic<uint64_t> bytesWritten = 0;
+        std::atomic<uint64_t> writeErrors = 0;
+
+    public:
+        FrameRecorder(const std::string& path, const FrameFormat& format, const Options& recorderOptions);
+
+        bool record(const cv::Mat& frame, const FrameMetaData& metaData);
+        Statistics getStatistics() const;
+        void close();
+
+        ~FrameRecorder();
+
+    private:
+        void writer();
+        bool writeChunk(const size_t chunk);
+        bool writeBlocks(const void* data, const size_t bytes, const uint64_t offset);
+        void writeHeader(const uint64_t indexOffset, const uint64_t frameCount);
+        void publishCurrentChunk();
+};
+
+#endif
@@ -0,0 +1,246 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#include <algorithm>
+#include <cstring>
+
+#include <opencv2/core/hal/intrin.hpp>
+
+#include "frame-statistics.hpp"
+
+using Histograms = uint32_t[4][FrameStatistics::HISTOGRAM_BINS];
+
+static void scanRow8(const uint8_t* row, const int32_t width, Histograms& histograms, uint64_t* sums)
+{
+    // the even and odd column sums (i.e. the bayer channels of the row), 32 pixels at a time
+    // note, the 32 bit lanes can't overflow, each only accumulates 1020 per 32 pixels
+    //
+    int32_t x = 0;
+#if CV_SIMD128
+    cv::v_uint32x4 even = cv::v_setzero_u32(), odd = cv::v_setzero_u32();
+    for (; x <= (width - 32); x += 32)
+    {
+        cv::v_uint8x16 evenPixels, oddPixels;
+        cv::v_load_deinterleave(row + x, evenPixels, oddPixels);
+
+        cv::v_uint16x8 low, high;
+        cv::v_uint32x4 first, second;
+        cv::v_expand(evenPixels, low, high);
+        cv::v_expand(low + high, first, second);
+        even = even + first + second;
+
+        cv::v_expand(oddPixels, low, high);
+        cv::v_expand(low + high, first, second);
+        odd = odd + first + second;
+    }
+
+    sums[0] += cv::v_reduce_sum(even);
+    sums[1] += cv::v_reduce_sum(odd);
+#endif
+
+    for (; x < width; x++) sums[x & 1] += row[x];
+
+    // note, 4 interleaved histograms, so that neighbouring pixels of the same value don't serialise on the same counter
+    //
+    int32_t i = 0;
+    for (; (i + 4) <= width; i += 4)
+    {
+        histograms[0][row[i]]++;
+        histograms[1][row[i + 1]]++;
+        histograms[2][row[i + 2]]++;
+        histograms[3][row[i + 3]]++;
+    }
+
+    for (; i < width; i++) histograms[0][row[i]]++;
+}
+
+static void scanRow16(const uint16_t* row, const int32_t width, const int32_t shift, const uint32_t maximum, Histograms& histograms, uint64_t* sums, uint64_t& saturated)
+{
+    // the even and odd column sums and the saturated count, 16 pixels at a time
+    // notes 1, the 32 bit lanes can't overflow for rows of up to 500K pixels, each only accumulates 131070 per 16 pixels
+    //       2, a comparison is all ones where the pixel is saturated, i.e. shifted down to 1 so that it can be summed as a count
+    //
+    int32_t x = 0;
+#if CV_SIMD128
+    const cv::v_uint16x8 limit = cv::v_setall_u16(static_cast<uint16_t>(std::min<uint32_t>(maximum, UINT16_MAX)));
+    cv::v_uint32x4 even = cv::v_setzero_u32(), odd = cv::v_setzero_u32(), over = cv::v_setzero_u32();
+    for (; x <= (width - 16); x += 16)
+    {
+        cv::v_uint16x8 evenPixels, oddPixels;
+        cv::v_load_deinterleave(row + x, evenPixels, oddPixels);
+
+        cv::v_uint32x4 low, high;
+        cv::v_expand(evenPixels, low, high);
+        even = even + low + high;
+
+        cv::v_expand(oddPixels, low, high);
+        odd = odd + low + high;
+
+        cv::v_expand(cv::v_shr<15>(evenPixels >= limit) + cv::v_shr<15>(oddPixels >= limit), low, high);
+        over = over + low + high;
+    }
+
+    sums[0] += cv::v_reduce_sum(even);
+    sums[1] += cv::v_reduce_sum(odd);
+    saturated += cv::v_reduce_sum(over);
+#endif
+
+    for (; x < width; x++)
+    {
+        sums[x & 1] += row[x];
+        if (row[x] >= maximum) saturated++;
+    }
+
+    // note, the histogram is a scatter so it stays scalar, interleaved as for the 8 bit rows
+    //
+    for (int32_t i = 0; i < width; i++) histograms[i & 3][std::min<uint32_t>(row[i] >> shift, FrameStatistics::HISTOGRAM_BINS - 1)]++;
+}
+
+bool FrameStatistics::compute(const cv::Mat& source, const FrameFormat& format, cv::Mat* destination, FrameStatistics& statistics)
+{
+    // returns false if the frame is not supported (i.e. the statistics are not valid), the frame is still copied to the destination
+    // note, dispatches to the kernel specialised for the frame's depth and bayer pattern, i.e. once per frame
+    //
+    const Kernel kernel = kernelFor(source.type(), format.bayerPattern);
+    if (kernel != nullptr) return kernel(source, format, destination, statistics);
+
+    statistics = FrameStatistics();
+    if (destination) source.copyTo(*destination);
+
+    return false;
+}
+
+FrameStatistics::Kernel FrameStatistics::kernelFor(const int32_t type, const FrameFormat::BayerPattern pattern)
+{
+    // returns nullptr if the type is not supported, i.e. not single channel 8 or 16 bit
+    //
+    const bool wide = (type == CV_16UC1);
+    if (!wide && (type != CV_8UC1)) return nullptr;
+
+    switch (pattern)
+    {
+        case FrameFormat::BayerPattern::GBRG:
+            return wide ? &compute<CV_16U, FrameFormat::BayerPattern::GBRG> : &compute<CV_8U, FrameFormat::BayerPattern::GBRG>;
+
+        case FrameFormat::BayerPattern::RGGB:
+            return wide ? &compute<CV_16U, FrameFormat::BayerPattern::RGGB> : &compute<CV_8U, FrameFormat::BayerPattern::RGGB>;
+
+        case FrameFormat::BayerPattern::GRBG:
+            return wide ? &compute<CV_16U, FrameFormat::BayerPattern::GRBG> : &compute<CV_8U, FrameFormat::BayerPattern::GRBG>;
+
+        case FrameFormat::BayerPattern::BGGR:
+            return wide ? &compute<CV_16U, FrameFormat::BayerPattern::BGGR> : &compute<CV_8U, FrameFormat::BayerPattern::BGGR>;
+
+        default:
+            return wide ? &compute<CV_16U, FrameFormat::BayerPattern::NONE> : &compute<CV_8U, FrameFormat::BayerPattern::NONE>;
+    }
+}
+
+template<int32_t Depth, FrameFormat::BayerPattern Pattern>
+bool FrameStatistics::compute(const cv::Mat& source, const FrameFormat& format, cv::Mat* destination, FrameStatistics& statistics)
+{
+    // the kernel specialised for a single channel pixel format, i.e. the depth and bayer pattern are resolved at compile time
+    // note, as for cv::Mat::copyTo(), the destination is only (re)allocated if its size or type has changed
+    //
+    static_assert((Depth == CV_8U) || (Depth == CV_16U), "The statistics are only supported for 8 and 16 bit frames");
+    constexpr bool wide = (Depth == CV_16U);
+
+    statistics = FrameStatistics();
+    if (source.type() != CV_MAKETYPE(Depth, 1))
+    {
+        if (destination) source.copyTo(*destination);
+        return false;
+    }
+
+    if (destination) destination->create(source.rows, source.cols, source.type());
+
+    const int32_t bitDepth = (format.bitDepth > 0) ? format.bitDepth : (wide ? 16 : 8);
+    const int32_t shift = std::max(bitDepth - 8, 0);
+    const uint32_t maximum = (1u << bitDepth) - 1;
+    const size_t rowBytes = source.cols * source.elemSize();
+
+    Histograms histograms = {};
+    uint64_t sums[2][2] = {};
+    uint64_t saturated = 0;
+    for (int32_t y = 0; y < source.rows; y++)
+    {
+        // the row is copied first, so that it is still in the cache when it is scanned
+        //
+        const uint8_t* row = source.ptr(y);
+        if (destination)
+        {
+            memcpy(destination->ptr(y), row, rowBytes);
+            row = destination->ptr(y);
+        }
+
+        if constexpr (wide) scanRow16(reinterpret_cast<const uint16_t*>(row), source.cols, shift, maximum, histograms, sums[y & 1], saturated);
+        else scanRow8(row, source.cols, histograms, sums[y & 1]);
+    }
+
+    for (size_t bin = 0; bin < HISTOGRAM_BINS; bin++) statistics.histogram[bin] = histograms[0][bin] + histograms[1][bin] + histograms[2][bin] + histograms[3][bin];
+    if constexpr (!wide) saturated = statistics.histogram[HISTOGRAM_BINS - 1];
+
+    const double pixels = double(source.rows) * source.cols;
+    statistics.valid = true;
+    statistics.saturated = saturated;
+    statistics.mean = (pixels > 0) ? ((sums[0][0] + sums[0][1] + sums[1][0] + sums[1][1]) / pixels) : 0.0;
+    if constexpr (Pattern == FrameFormat::BayerPattern::NONE) return true;
+    if ((source.rows < 2) || (source.cols < 2)) return true;
+
+    // the mean of each 2x2 position, i.e. [row parity][column parity], then assigned to the bayer channels using the pattern
+    //
+    double means[2][2];
+    for (int32_t r = 0; r < 2; r++)
+    {
+        for (int32_t c = 0; c < 2; c++)
+        {
+            const double count = double((source.rows + 1 - r) / 2) * ((source.cols + 1 - c) / 2);
+            means[r][c] = sums[r][c] / count;
+        }
+    }
+
+    if constexpr (Pattern == FrameFormat::BayerPattern::RGGB)
+    {
+        statistics.red = means[0][0];
+        statistics.greenRed = means[0][1];
+        statistics.greenBlue = means[1][0];
+        statistics.blue = means[1][1];
+    }
+    else if constexpr (Pattern == FrameFormat::BayerPattern::GRBG)
+    {
+        statistics.greenRed = means[0][0];
+        statistics.red = means[0][1];
+        statistics.blue = means[1][0];
+        statistics.greenBlue = means[1][1];
+    }
+    else if constexpr (Pattern == FrameFormat::BayerPattern::GBRG)
+    {
+        statistics.greenBlue = means[0][0];
+        statistics.blue = means[0][1];
+        statistics.red = means[1][0];
+        statistics.greenRed = means[1][1];
+    }
+    else if constexpr (Pattern == FrameFormat::BayerPattern::BGGR)
+    {
+        statistics.blue = means[0][0];
+        statistics.greenBlue = means[0][1];
+        statistics.greenRed = means[1][0];
+        statistics.red = means[1][1];
+    }
+
+    return true;
+}
+
+// the specialised kernels, i.e. for each supported depth and bayer pattern, see PixelFormat
+//
+template bool FrameStatistics::compute<CV_8U, FrameFormat::BayerPattern::NONE>(const cv::Mat&, const FrameFormat&, cv::Mat*, FrameStatistics&);
+template bool FrameStatistics::compute<CV_8U, FrameFormat::BayerPattern::GBRG>(const cv::Mat&, const FrameFormat&, cv::Mat*, FrameStatistics&);
+template bool FrameStatistics::compute<CV_8U, FrameFormat::BayerPattern::RGGB>(const cv::Mat&, const FrameFormat&, cv::Mat*, FrameStatistics&);
+template bool FrameStatistics::compute<CV_8U, FrameFormat::BayerPattern::GRBG>(const cv::Mat&, const FrameFormat&, cv::Mat*, FrameStatistics&);
+template bool FrameStatistics::compute<CV_8U, FrameFormat::BayerPattern::BGGR>(const cv::Mat&, const FrameFormat&, cv::Mat*, FrameStatistics&);
+template bool FrameStatistics::compute<CV_16U, FrameFormat::BayerPattern::NONE>(const cv::Mat&, const FrameFormat&, cv::Mat*, FrameStatistics&);
+template bool FrameStatistics::compute<CV_16U, FrameFormat::BayerPattern::GBRG>(const cv::Mat&, const FrameFormat&, cv::Mat*, FrameStatistics&);
+template bool FrameStatistics::compute<CV_16U, FrameFormat::BayerPattern::RGGB>(const cv::Mat&, const FrameFormat&, cv::Mat*, FrameStatistics&);
+template bool FrameStatistics::compute<CV_16U, FrameFormat::BayerPattern::GRBG>(const cv::Mat&, const FrameFormat&, cv::Mat*, FrameStatistics&);
+template bool FrameStatistics::compute<CV_16U, FrameFormat::BayerPattern::BGGR>(const cv::Mat&, const FrameFormat&, cv::Mat*, FrameStatistics&);
@@ -0,0 +1,48 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#ifndef H_FRAME_STATISTICS
+#define H_FRAME_STATISTICS
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include <opencv2/opencv.hpp>
+
+#include "frame-format.hpp"
+
+// the per frame exposure statistics, i.e. for exposure control, white balance and quality checks, see GigEVideoCapture::setFrameStatistics()
+// notes 1, compute() copies the frame (if a destination is given) and computes the statistics in the same pass, i.e. the frame is only read from memory once
+//          each row is copied and then scanned while it is still in the L1 cache, the bayer channel sums (and the 16 bit saturated count) use the
+//          OpenCV universal intrinsics (i.e. NEON or SSE), the histogram is scalar
+//       2, only single channel 8 and 16 bit frames are supported (i.e. GRAY8, GRAY16_LE and the raw bayer formats), otherwise the statistics are not valid
+//       3, the mean is in the frame's own value range (i.e. 0 to 4095 for a 12 bit frame), the histogram has 256 bins of the most significant 8 bits
+//       4, saturated is the number of pixels at the maximum value for the frame's bit depth
+//       5, for bayer frames the mean of each of the four bayer channels is given, i.e. greenRed is the green on the red rows, for white balance
+//       6, compute<Depth, Pattern>() is the kernel specialised for a pixel format (i.e. no per row format branches), compute() dispatches to it once per frame
+//       7, a frame's statistics are referenced (rather than embedded) by its FrameMetaData, as the histogram alone is 1KB
+//
+struct FrameStatistics
+{
+    static constexpr size_t HISTOGRAM_BINS = 256;
+
+    bool valid = false;
+    double mean = 0.0;
+    uint64_t saturated = 0;
+    std::array<uint32_t, HISTOGRAM_BINS> histogram = {};
+    double red = 0.0;
+    double greenRed = 0.0;
+    double greenBlue = 0.0;
+    double blue = 0.0;
+
+    using Kernel = bool (*)(const cv::Mat& source, const FrameFormat& format, cv::Mat* destination, FrameStatistics& statistics);
+
+    static bool compute(const cv::Mat& source, const FrameFormat& format, cv::Mat* destination, FrameStatistics& statistics);
+    template<int32_t Depth, FrameFormat::BayerPattern Pattern>
+    static bool compute(const cv::Mat& source, const FrameFormat& format, cv::Mat* destination, FrameStatistics& statistics);
+    static Kernel kernelFor(const int32_t type, const FrameFormat::BayerPattern pattern);
+};
+
+#endif
@@ -0,0 +1,151 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#include <algorithm>
+
+#include "frame-views.hpp"
+
+bool FrameViews::addRegion(const std::string& name, const cv::Rect& region, std::string& error)
+{
+    if (!isUnique(name, error)) return false;
+    if (region.empty())
+    {
+        error = "The region for view: " + name + " is empty";
+        return false;
+    }
+
+    views.emplace_back(View{name, Kind::REGION, region, 0});
+    return true;
+}
+
+bool FrameViews::addPyramidLevel(const std::string& name, const int32_t level, std::string& error)
+{
+    if (!isUnique(name, error)) return false;
+    if ((level < 1) || (level > MAXIMUM_LEVEL))
+    {
+        error = "The pyramid level for view: " + name + " must be from 1 to " + std::to_string(MAXIMUM_LEVEL);
+        return false;
+    }
+
+    views.emplace_back(View{name, Kind::PYRAMID, cv::Rect(), level});
+
+    // note, the pyramid levels are produced from the highest resolution (i.e. lowest level) down, see generate()
+    //
+    pyramidOrder.emplace_back(views.size() - 1);
+    std::stable_sort(pyramidOrder.begin(), pyramidOrder.end(), [this](const size_t a, const size_t b) { return views[a].level < views[b].level; });
+
+    return true;
+}
+
+void FrameViews::clear()
+{
+    views.clear();
+    pyramidOrder.clear();
+}
+
+bool FrameViews::empty() const
+{
+    return views.empty();
+}
+
+size_t FrameViews::size() const
+{
+    return views.size();
+}
+
+int32_t FrameViews::find(const std::string& name) const
+{
+    // returns the view's index, or -1 if there is no such view
+    //
+    for (size_t i = 0; i < views.size(); i++) if (views[i].name == name) return static_cast<int32_t>(i);
+    return -1;
+}
+
+FrameViews::Kind FrameViews::getKind(const size_t index) const
+{
+    return views.at(index).kind;
+}
+
+std::vector<std::string> FrameViews::getNames() const
+{
+    auto names = std::vector<std::string>();
+    for (const auto& view : views) names.emplace_back(view.name);
+
+    return names;
+}
+
+void FrameViews::generate(const cv::Mat& frame, const bool bayer, std::vector<cv::Mat>& outputs) const
+{
+    generateRegions(frame, bayer, outputs);
+    generatePyramid(frame, outputs);
+}
+
+void FrameViews::generateRegions(const cv::Mat& frame, const bool bayer, std::vector<cv::Mat>& outputs) const
+{
+    // note, the region outputs share the frame's buffer, i.e. they have the same lifetime and ownership as the frame
+    //
+    outputs.resize(views.size());
+    const auto bounds = cv::Rect(0, 0, frame.cols, frame.rows);
+    for (size_t i = 0; i < views.size(); i++)
+    {
+        if (views[i].kind != Kind::REGION) continue;
+
+        auto region = views[i].region;
+        if (bayer)
+        {
+            region.width += region.x & 1;
+            region.height += region.y & 1;
+            region.x &= ~1;
+            region.y &= ~1;
+        }
+
+        region &= bounds;
+        if (frame.empty() || region.empty()) outputs[i].release();
+        else outputs[i] = frame(region);
+    }
+}
+
+void FrameViews::generatePyramid(const cv::Mat& frame, std::vector<cv::Mat>& outputs) const
+{
+    // note, a pyramid output is only (re)allocated if its size or type has changed, i.e. cv::resize() reuses the output's buffer
+    //
+    outputs.resize(views.size());
+    if (frame.empty())
+    {
+        for (const size_t i : pyramidOrder) outputs[i].release();
+        return;
+    }
+
+    // each level from the nearest level already produced, i.e. a repeated 2x downscale (unless a level has been skipped, then 4x or more)
+    //
+    const cv::Mat* previous = &frame;
+    int32_t previousLevel = 0;
+    for (const size_t i : pyramidOrder)
+    {
+        const int32_t scale = 1 << views[i].level;
+        const auto size = cv::Size(std::max(frame.cols / scale, 1), std::max(frame.rows / scale, 1));
+        if (views[i].level == previousLevel)
+        {
+            // the same level has been added more than once, so shares the buffer
+            //
+            outputs[i] = *previous;
+            continue;
+        }
+
+        cv::resize(*previous, outputs[i], size, 0, 0, cv::INTER_AREA);
+        previous = &outputs[i];
+        previousLevel = views[i].level;
+    }
+}
+
+bool FrameViews::isUnique(const std::string& name, std::string& error) const
+{
+    if (name.empty() || (find(name) >= 0))
+    {
+        error = "The view name: " + name + " is empty or has already been added";
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,62 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#ifndef H_FRAME_VIEWS
+#define H_FRAME_VIEWS
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+// the named views of each delivered frame, i.e. the regions of interest and the pyramid levels, produced once per frame rather than by each consumer
+// notes 1, a region is a zero copy view (i.e. a cv::Mat header) of the delivered frame, it is clipped to the frame
+//          for bayer frames the region's origin is rounded down to even, i.e. so that it has the same bayer pattern as the frame
+//       2, a pyramid level is the whole frame downscaled by 2^level (level 1 to 4), using an area (i.e. box filter) downscale, produced into a buffer that is reused
+//          each level is produced from the nearest level above it, i.e. a 2x downscale of the previous level (the vectorised cv::resize() INTER_AREA path)
+//       3, for bayer frames the 1st pyramid level bins each 2x2 bayer cell, i.e. it is a half resolution mono image
+//       4, generate() produces the views in the order they were added, outputs[i] is the view added i'th
+//       5, generateRegions() and generatePyramid() each produce only their kind of view (leaving the other outputs unchanged)
+//          i.e. so that the pyramid levels can be produced once per frame and shared, while each copy of the frame has its own region headers
+//
+class FrameViews
+{
+    public:
+        enum class Kind { REGION, PYRAMID };
+
+        struct View
+        {
+            std::string name;
+            Kind kind;
+            cv::Rect region;
+            int32_t level;
+        };
+
+        static constexpr int32_t MAXIMUM_LEVEL = 4;
+
+    private:
+        std::vector<View> views;
+        std::vector<size_t> pyramidOrder;
+
+    public:
+        bool addRegion(const std::string& name, const cv::Rect& region, std::string& error);
+        bool addPyramidLevel(const std::string& name, const int32_t level, std::string& error);
+        void clear();
+
+        bool empty() const;
+        size_t size() const;
+        int32_t find(const std::string& name) const;
+        Kind getKind(const size_t index) const;
+        std::vector<std::string> getNames() const;
+
+        void generate(const cv::Mat& frame, const bool bayer, std::vector<cv::Mat>& outputs) const;
+        void generateRegions(const cv::Mat& frame, const bool bayer, std::vector<cv::Mat>& outputs) const;
+        void generatePyramid(const cv::Mat& frame, std::vector<cv::Mat>& outputs) const;
+
+    private:
+        bool isUnique(const std::string& name, std::string& error) const;
+};
+
+#endif
@@ -0,0 +1,397 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "capture-telemetry.hpp"
+#include "gige-video-capture.hpp"
+
+//
+// a headless benchmark of the capture hot path, i.e. no camera is required
+// notes 1, drives GigEVideoCapture from videotestsrc pipelines across a matrix of resolutions, formats and frame rates
+//       2, a frame rate of 0 runs the source as fast as possible (i.e. not live), otherwise the source is live at the given rate
+//       3, the bayer formats are produced using rgb2bayer (gst-plugins-bad)
+//       4, the results are written to stdout as CSV (the default) or JSON, any progress is written to stderr
+//       5, the pattern is a videotestsrc pattern, i.e. ball (moving) or smpte (static), alternate switches between the two every second to exercise the change detection
+//
+// usage: gige-bench [--format csv|json] [--duration seconds] [--resolutions 640x480,1280x960] [--formats GRAY8,GRAY16_LE,gbrg]
+//                   [--framerates 30,0] [--capture on-demand|continuous] [--zero-copy] [--pattern ball|smpte|alternate] [--change-threshold value]
+//
+
+// counts the heap allocations made by the whole process (i.e. OpenCV, GLib and gstreamer as well as C++ new)
+// note, glibc specific, these interpose the libc allocation functions
+//
+static std::atomic<uint64_t> allocationCount = 0;
+
+extern "C"
+{
+    extern void* __libc_malloc(size_t size);
+    extern void* __libc_calloc(size_t count, size_t size);
+    extern void* __libc_realloc(void* pointer, size_t size);
+    extern void* __libc_memalign(size_t alignment, size_t size);
+    extern void* __libc_valloc(size_t size);
+    extern void* __libc_pvalloc(size_t size);
+
+    void* malloc(size_t size)
+    {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        return __libc_malloc(size);
+    }
+
+    void* calloc(size_t count, size_t size)
+    {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc(void* pointer, size_t size)
+    {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        return __libc_realloc(pointer, size);
+    }
+
+    // note, the aligned allocations are used by OpenCV's fastMalloc() and GLib's slices (and by the aligned C++ new), so are also counted
+    //
+    int posix_memalign(void** pointer, size_t alignment, size_t size)
+    {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        if ((alignment % sizeof(void*)) != 0) return EINVAL;
+
+        void* allocated = __libc_memalign(alignment, size);
+        if (allocated == nullptr) return ENOMEM;
+
+        *pointer = allocated;
+        return 0;
+    }
+
+    void* aligned_alloc(size_t alignment, size_t size)
+    {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        return __libc_memalign(alignment, size);
+    }
+
+    void* memalign(size_t alignment, size_t size)
+    {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        return __libc_memalign(alignment, size);
+    }
+
+    void* valloc(size_t size)
+    {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        return __libc_valloc(size);
+    }
+
+    void* pvalloc(size_t size)
+    {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        return __libc_pvalloc(size);
+    }
+}
+
+struct BenchConfig
+{
+    std::string outputFormat = "csv";
+    double duration = 5.0;
+    std::vector<std::pair<int32_t, int32_t>> resolutions = {{640, 480}, {1280, 960}, {1920, 1080}};
+    std::vector<std::string> formats = {"GRAY8", "GRAY16_LE", "gbrg"};
+    std::vector<int32_t> frameRates = {30, 0};
+    GigEVideoCapture::CaptureMode captureMode = GigEVideoCapture::CaptureMode::CONTINUOUS;
+    bool zeroCopy = false;
+    GigEVideoCapture::IngestOptions ingest;
+    ThreadScheduling scheduling;
+    std::string pattern = "ball";
+    ChangeDetector::Options changeDetection;
+};
+
+struct BenchResult
+{
+    int32_t width, height, frameRate;
+    std::string format;
+    uint64_t frames = 0;
+    double measuredFrameRate = 0.0;
+    double cpuPerFrame = 0.0;
+    double allocationsPerFrame = 0.0;
+    LatencyHistogram::Snapshot grabWait;
+    LatencyHistogram::Snapshot arrivalJitter;
+    CaptureTelemetry::Snapshot telemetry;
+    GigEVideoCapture::IngestStatistics ingest;
+};
+
+static std::vector<std::string> split(const std::string& value, const char delimiter)
+{
+    auto items = std::vector<std::string>();
+    std::stringstream ss(value);
+    std::string item;
+    while (std::getline(ss, item, delimiter)) if (!item.empty()) items.emplace_back(item);
+
+    return items;
+}
+
+static BenchConfig parseArguments(const int32_t argc, char* argv[])
+{
+    auto config = BenchConfig();
+    for (int32_t i = 1; i < argc; i++)
+    {
+        const auto argument = std::string(argv[i]);
+        const auto value = [&]() {
+            if ((i + 1) >= argc) throw std::string("Missing value for argument: ") + argument;
+            return std::string(argv[++i]);
+        };
+
+        if (argument == "--format") config.outputFormat = value();
+        else if (argument == "--duration") config.duration = std::stod(value());
+        else if (argument == "--zero-copy") config.zeroCopy = true;
+        else if (argument == "--capture")
+        {
+            const auto mode = value();
+            if (mode == "on-demand") config.captureMode = GigEVideoCapture::CaptureMode::ON_DEMAND;
+            else if (mode == "continuous") config.captureMode = GigEVideoCapture::CaptureMode::CONTINUOUS;
+            else throw std::string("Unknown capture mode: ") + mode;
+        }
+        else if (argument == "--ingest")
+        {
+            const auto mode = value();
+            if (mode == "signal") config.ingest.mode = GigEVideoCapture::IngestMode::SIGNAL;
+            else if (mode == "pull") config.ingest.mode = GigEVideoCapture::IngestMode::PULL_THREAD;
+            else throw std::string("Unknown ingest mode: ") + mode;
+        }
+        else if (argument == "--max-buffers") config.ingest.maxBuffers = std::stoul(value());
+        else if (argument == "--pattern") config.pattern = value();
+        else if (argument == "--change-threshold")
+        {
+            config.changeDetection.enabled = true;
+            config.changeDetection.threshold = std::stod(value());
+        }
+        else if (argument == "--cpus")
+        {
+            config.scheduling.cpus.clear();
+            for (const auto& cpu : split(value(), ',')) config.scheduling.cpus.emplace_back(std::stoi(cpu));
+        }
+        else if (argument == "--rt-priority")
+        {
+            config.scheduling.policy = ThreadScheduling::Policy::FIFO;
+            config.scheduling.priority = std::stoi(value());
+        }
+        else if (argument == "--resolutions")
+        {
+            config.resolutions.clear();
+            for (const auto& resolution : split(value(), ','))
+            {
+                const auto dimensions = split(resolution, 'x');
+                if (dimensions.size() != 2) throw std::string("Invalid resolution: ") + resolution;
+                config.resolutions.emplace_back(std::stoi(dimensions[0]), std::stoi(dimensions[1]));
+            }
+        }
+        else if (argument == "--formats") config.formats = split(value(), ',');
+        else if (argument == "--framerates")
+        {
+            config.frameRates.clear();
+            for (const auto& frameRate : split(value(), ',')) config.frameRates.emplace_back(std::stoi(frameRate));
+        }
+        else throw std::string("Unknown argument: ") + argument;
+    }
+
+    if ((config.outputFormat != "csv") && (config.outputFormat != "json")) throw std::string("Unknown output format: ") + config.outputFormat;
+    return config;
+}
+
+static std::string createPipeline(const int32_t width, const int32_t height, const std::string& format, const int32_t frameRate, const std::string& pattern)
+{
+    // notes 1, the unpaced sources use a nominal 1000/1 frame rate, as the appsink does not synchronise this is as fast as possible
+    //       2, the alternate pattern starts as ball, the source is named so that runBenchmark() can switch its pattern
+    //
+    const bool live = (frameRate > 0);
+    const auto rate = std::to_string(live ? frameRate : 1000) + "/1";
+    const auto size = "width=" + std::to_string(width) + ",height=" + std::to_string(height) + ",framerate=" + rate;
+
+    std::stringstream ss;
+    ss << "videotestsrc name=source is-live=" << (live ? "true" : "false") << " pattern=" << ((pattern == "alternate") ? "ball" : pattern) << " ! ";
+    const bool bayer = (format.size() >= 4) && ((format.substr(0, 4) == "gbrg") || (format.substr(0, 4) == "rggb") || (format.substr(0, 4) == "grbg") || (format.substr(0, 4) == "bggr"));
+    if (bayer) ss << "video/x-raw,format=ARGB," << size << " ! rgb2bayer ! video/x-bayer,format=" << format << "," << size;
+    else ss << "video/x-raw,format=" << format << "," << size;
+    ss << " ! appsink";
+
+    return ss.str();
+}
+
+static uint64_t processCpuTime()
+{
+    timespec time;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time);
+
+    return (uint64_t(time.tv_sec) * 1000000000) + time.tv_nsec;
+}
+
+static BenchResult runBenchmark(const BenchConfig& config, const int32_t width, const int32_t height, const std::string& format, const int32_t frameRate)
+{
+    auto result = BenchResult();
+    result.width = width;
+    result.height = height;
+    result.format = format;
+    result.frameRate = frameRate;
+
+    auto capture = GigEVideoCapture(createPipeline(width, height, format, frameRate, config.pattern));
+    capture.setCaptureMode(config.captureMode);
+    capture.setIngestion(config.ingest);
+    capture.setChangeDetection(config.changeDetection);
+
+    // note, the streaming and capture threads are pinned (and optionally given a real time priority), the consuming (i.e. this) thread is not
+    //
+    capture.setThreadScheduling(GigEVideoCapture::ThreadRole::STREAMING, config.scheduling);
+    capture.setThreadScheduling(GigEVideoCapture::ThreadRole::CAPTURE, config.scheduling);
+    if (config.zeroCopy) capture.setGrabMode(GigEVideoCapture::GrabMode::ZERO_COPY);
+    if (!capture.start()) throw std::string("Unable to start the pipeline for: ") + format;
+
+    // warm up, i.e. the caps negotiation and the frame buffer allocations are not part of the measurement
+    //
+    auto frame = cv::Mat();
+    const auto warmUp = std::chrono::steady_clock::now() + std::chrono::milliseconds(500);
+    while (std::chrono::steady_clock::now() < warmUp) capture.tryGrab(frame, std::chrono::milliseconds(1000), GigEVideoCapture::GrabPolicy::QUEUED);
+
+    capture.resetTelemetry();
+    // the arrival jitter is the deviation of each frame arrival interval from the nominal frame period
+    // note, only measured for paced sources and consecutive frames, i.e. not across a discarded or dropped frame
+    //
+    LatencyHistogram grabWait, arrivalJitter;
+    const int64_t period = (frameRate > 0) ? (1000000000 / frameRate) : 0;
+    uint64_t previousArrival = 0, previousSequence = 0;
+
+    const uint64_t cpuStart = processCpuTime();
+    const uint64_t allocationStart = allocationCount.load();
+    const auto start = std::chrono::steady_clock::now();
+    const auto end = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(config.duration));
+
+    const bool alternate = (config.pattern == "alternate");
+    auto nextSwitch = start + std::chrono::seconds(1);
+    bool moving = true;
+
+    while (std::chrono::steady_clock::now() < end)
+    {
+        if (alternate && (std::chrono::steady_clock::now() >= nextSwitch))
+        {
+            moving = !moving;
+            capture.setStringProperty("source", "pattern", moving ? "ball" : "smpte");
+            nextSwitch += std::chrono::seconds(1);
+        }
+
+        const uint64_t grabStart = CaptureTelemetry::now();
+        if (!capture.tryGrab(frame, std::chrono::milliseconds(1000), GigEVideoCapture::GrabPolicy::QUEUED)) continue;
+
+        grabWait.record(CaptureTelemetry::now() - grabStart);
+        result.frames++;
+
+        const auto& metaData = capture.getFrameMetaData();
+        if ((period > 0) && (previousArrival > 0) && (metaData.sequence == (previousSequence + 1)))
+        {
+            arrivalJitter.record(std::abs(static_cast<int64_t>(metaData.arrivalTime - previousArrival) - period));
+        }
+
+        previousArrival = metaData.arrivalTime;
+        previousSequence = metaData.sequence;
+    }
+
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const uint64_t cpuTime = processCpuTime() - cpuStart;
+    const uint64_t allocations = allocationCount.load() - allocationStart;
+    result.telemetry = capture.getTelemetry();
+    result.ingest = capture.getIngestStatistics();
+    capture.stop();
+
+    result.grabWait = grabWait.snapshot();
+    result.arrivalJitter = arrivalJitter.snapshot();
+    for (const auto& error : capture.getThreadSchedulingErrors()) std::cerr << error << "\n";
+    result.measuredFrameRate = result.frames / elapsed;
+    if (result.frames > 0)
+    {
+        result.cpuPerFrame = double(cpuTime) / result.frames;
+        result.allocationsPerFrame = double(allocations) / result.frames;
+    }
+
+    return result;
+}
+
+static void writeCsv(const std::vector<BenchResult>& results)
+{
+    std::cout << "width,height,format,framerate,frames,fps,handler_mean_us,handler_p99_us,grab_p50_us,grab_p90_us,grab_p99_us,grab_max_us,cpu_us_per_frame,allocs_per_frame,dropped,discarded,unchanged,ingest_dropped,queue_peak,jitter_p50_us,jitter_p99_us,jitter_max_us\n";
+    std::cout << std::fixed << std::setprecision(3);
+    for (const auto& result : results)
+    {
+        std::cout << result.width << "," << result.height << "," << result.format << "," << result.frameRate << ",";
+        std::cout << result.frames << "," << result.measuredFrameRate << ",";
+        std::cout << (result.telemetry.handlerLatency.mean / 1000.0) << "," << (result.telemetry.handlerLatency.p99 / 1000.0) << ",";
+        std::cout << (result.grabWait.p50 / 1000.0) << "," << (result.grabWait.p90 / 1000.0) << "," << (result.grabWait.p99 / 1000.0) << "," << (result.grabWait.max / 1000.0) << ",";
+        std::cout << (result.cpuPerFrame / 1000.0) << "," << result.allocationsPerFrame << ",";
+        std::cout << result.telemetry.dropped << "," << result.telemetry.discarded << "," << result.telemetry.unchanged << "," << result.ingest.dropped << "," << result.ingest.peakOccupancy << ",";
+        std::cout << (result.arrivalJitter.p50 / 1000.0) << "," << (result.arrivalJitter.p99 / 1000.0) << "," << (result.arrivalJitter.max / 1000.0) << "\n";
+    }
+}
+
+static void writeJson(const std::vector<BenchResult>& results)
+{
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "[\n";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const auto& result = results[i];
+        std::cout << "  {\"width\": " << result.width << ", \"height\": " << result.height << ", \"format\": \"" << result.format << "\", \"framerate\": " << result.frameRate;
+        std::cout << ", \"frames\": " << result.frames << ", \"fps\": " << result.measuredFrameRate;
+        std::cout << ", \"handler_mean_us\": " << (result.telemetry.handlerLatency.mean / 1000.0) << ", \"handler_p99_us\": " << (result.telemetry.handlerLatency.p99 / 1000.0);
+        std::cout << ", \"grab_p50_us\": " << (result.grabWait.p50 / 1000.0) << ", \"grab_p90_us\": " << (result.grabWait.p90 / 1000.0);
+        std::cout << ", \"grab_p99_us\": " << (result.grabWait.p99 / 1000.0) << ", \"grab_max_us\": " << (result.grabWait.max / 1000.0);
+        std::cout << ", \"cpu_us_per_frame\": " << (result.cpuPerFrame / 1000.0) << ", \"allocs_per_frame\": " << result.allocationsPerFrame;
+        std::cout << ", \"dropped\": " << result.telemetry.dropped << ", \"discarded\": " << result.telemetry.discarded << ", \"unchanged\": " << result.telemetry.unchanged;
+        std::cout << ", \"ingest_dropped\": " << result.ingest.dropped << ", \"queue_peak\": " << result.ingest.peakOccupancy;
+        std::cout << ", \"jitter_p50_us\": " << (result.arrivalJitter.p50 / 1000.0) << ", \"jitter_p99_us\": " << (result.arrivalJitter.p99 / 1000.0) << ", \"jitter_max_us\": " << (result.arrivalJitter.max / 1000.0) << "}";
+        std::cout << (((i + 1) < results.size()) ? ",\n" : "\n");
+    }
+
+    std::cout << "]\n";
+}
+
+int32_t main(int32_t argc, char* argv[])
+{
+    gst_debug_set_default_threshold(GST_LEVEL_WARNING);
+    gst_init(&argc, &argv);
+
+    try
+    {
+        const auto config = parseArguments(argc, argv);
+
+        auto results = std::vector<BenchResult>();
+        for (const auto& [width, height] : config.resolutions)
+        {
+            for (const auto& format : config.formats)
+            {
+                for (const auto frameRate : config.frameRates)
+                {
+                    std::cerr << "Benchmarking: " << width << "x" << height << " " << format << " @ " << frameRate << " fps\n";
+                    results.emplace_back(runBenchmark(config, width, height, format, frameRate));
+                }
+            }
+        }
+
+        if (config.outputFormat == "json") writeJson(results);
+        else writeCsv(results);
+    }
+    catch (const std::string& exception)
+    {
+        std::cerr << "Exception: " << exception << "\n";
+        return 1;
+    }
+
+    return 0;
+}
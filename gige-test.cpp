@@ -0,0 +1,536 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "gige-video-capture.hpp"
+#include "multi-gige-video-capture.hpp"
+#include "typed-gige-video-capture.hpp"
+
+//
+// a headless test driver, i.e. asserts the capture behaviour using videotestsrc pipelines, no camera is required
+// notes 1, each test stops at its first failed check (a std::string is thrown), the remaining tests are still run
+//       2, the sources are not live and limited using num-buffers, i.e. the frames (and their timestamps) are the same every run
+//       3, the bayer formats are produced using rgb2bayer (gst-plugins-bad)
+//       4, the exit status is the number of failed tests, i.e. 0 if every test passed
+//
+// usage: gige-test [test name ...]
+//
+
+struct Test
+{
+    std::string name;
+    std::function<void()> run;
+};
+
+static const auto GRAB_TIMEOUT = std::chrono::milliseconds(5000);
+
+static void check(const bool condition, const std::string& message)
+{
+    if (!condition) throw message;
+}
+
+template <typename T>
+static void checkEqual(const T& actual, const T& expected, const std::string& message)
+{
+    if (actual == expected) return;
+
+    std::stringstream ss;
+    ss << message << ", expected: " << expected << ", actual: " << actual;
+    throw ss.str();
+}
+
+static bool isBayer(const std::string& format)
+{
+    const auto pattern = format.substr(0, 4);
+    return (pattern == "gbrg") || (pattern == "rggb") || (pattern == "grbg") || (pattern == "bggr");
+}
+
+static std::string createSource(const std::string& format, const int32_t width, const int32_t height, const int32_t frames, const std::string& properties = "")
+{
+    // note, the frame rate only sets the timestamps, the sources are not live so the frames are produced as fast as they are consumed
+    //
+    const auto size = "width=" + std::to_string(width) + ",height=" + std::to_string(height) + ",framerate=30/1";
+
+    std::stringstream ss;
+    ss << "videotestsrc num-buffers=" << frames << " " << properties << " ! ";
+    if (isBayer(format)) ss << "video/x-raw,format=ARGB," << size << " ! rgb2bayer ! video/x-bayer,format=" << format << "," << size;
+    else ss << "video/x-raw,format=" << format << "," << size;
+
+    return ss.str();
+}
+
+static std::unique_ptr<GigEVideoCapture> startCapture(const std::string& pipeline, const GigEVideoCapture::GrabMode mode, const size_t ringSize = 8)
+{
+    // note, CONTINUOUS so that the frames are kept until they are grabbed, i.e. the source can't run ahead of the 1st grab
+    //
+    auto capture = std::make_unique<GigEVideoCapture>(pipeline);
+    capture->setCaptureMode(GigEVideoCapture::CaptureMode::CONTINUOUS, ringSize);
+    capture->setGrabMode(mode);
+    check(capture->start(), "Unable to start the pipeline: " + pipeline);
+
+    return capture;
+}
+
+static cv::Mat grabNext(GigEVideoCapture& capture, const std::string& context)
+{
+    auto frame = cv::Mat();
+    check(capture.tryGrab(frame, GRAB_TIMEOUT, GigEVideoCapture::GrabPolicy::QUEUED), context + ", no frame was grabbed");
+
+    return frame;
+}
+
+static void testFormats()
+{
+    // the negotiated cv::Mat type and stride of each supported format
+    // notes 1, the width is chosen so that none of the rows are a multiple of 4 bytes, i.e. gstreamer pads every row to a 4 byte stride
+    //       2, a COPY frame is unpadded (continuous), a ZERO_COPY frame has the padded stride, both must have the same pixels
+    //
+    struct Expected
+    {
+        std::string format;
+        int32_t type;
+        size_t pixelBytes;
+    };
+
+    const std::vector<Expected> formats = {
+        {"GRAY8", CV_8UC1, 1}, {"GRAY16_LE", CV_16UC1, 2}, {"BGR", CV_8UC3, 3}, {"RGB", CV_8UC3, 3}, {"BGRx", CV_8UC4, 4}, {"gbrg", CV_8UC1, 1}, {"rggb", CV_8UC1, 1}
+    };
+
+    const int32_t width = 322, height = 242;
+    for (const auto& expected : formats)
+    {
+        const auto pipeline = createSource(expected.format, width, height, 4, "pattern=smpte") + " ! appsink";
+        const auto context = "format " + expected.format;
+
+        auto copyCapture = startCapture(pipeline, GigEVideoCapture::GrabMode::COPY);
+        const auto copied = grabNext(*copyCapture, context);
+        const auto format = copyCapture->getFrameFormat();
+        copyCapture->stop();
+
+        const size_t rowBytes = width * expected.pixelBytes;
+        const size_t stride = (rowBytes + 3) & ~size_t(3);
+        checkEqual(format.type, expected.type, context + ", the negotiated type");
+        checkEqual(format.width, width, context + ", the negotiated width");
+        checkEqual(format.height, height, context + ", the negotiated height");
+        checkEqual(format.rowBytes, rowBytes, context + ", the row bytes");
+        checkEqual(format.stride, stride, context + ", the stride");
+        checkEqual(format.isBayer(), isBayer(expected.format), context + ", the bayer pattern");
+
+        checkEqual(copied.type(), expected.type, context + ", the COPY frame type");
+        check((copied.cols == width) && (copied.rows == height), context + ", the COPY frame size");
+        check(copied.isContinuous(), context + ", the COPY frame is not continuous");
+
+        // note, the zero copy frame must be released before its pipeline
+        //
+        auto zeroCopyCapture = startCapture(pipeline, GigEVideoCapture::GrabMode::ZERO_COPY);
+        {
+            const auto wrapped = grabNext(*zeroCopyCapture, context);
+            checkEqual(wrapped.type(), expected.type, context + ", the ZERO_COPY frame type");
+            checkEqual(static_cast<size_t>(wrapped.step[0]), stride, context + ", the ZERO_COPY frame step");
+            check(cv::norm(copied, wrapped, cv::NORM_INF) == 0.0, context + ", the COPY and ZERO_COPY frames differ");
+        }
+
+        zeroCopyCapture->stop();
+    }
+}
+
+static void testSynchronisedSets()
+{
+    // the frame sets of two sources, 1st with identical timestamps and then with the 1st source a frame ahead of the 2nd
+    // notes 1, the rings hold every frame, i.e. none are dropped so the number of sets is exact
+    //       2, when offset the 2nd source's 1st frame has no match, it must be discarded and every later frame matched
+    //
+    const int32_t frames = 30;
+    const int64_t period = 1000000000 / 30;
+    const auto tolerance = std::chrono::milliseconds(5);
+
+    for (const int64_t offset : {int64_t(0), period})
+    {
+        const auto context = "offset " + std::to_string(offset);
+        const auto leading = createSource("GRAY8", 160, 120, frames, "timestamp-offset=" + std::to_string(offset)) + " ! appsink";
+        const auto trailing = createSource("GRAY8", 160, 120, frames) + " ! appsink";
+
+        auto capture = MultiGigEVideoCapture({leading, trailing}, tolerance, frames + 2);
+        check(capture.start(), context + ", unable to start the pipelines");
+
+        auto setFrames = std::vector<cv::Mat>();
+        auto setMetaData = std::vector<FrameMetaData>();
+        auto previous = std::vector<FrameMetaData>();
+        int32_t sets = 0;
+        while (capture.tryGrabSet(setFrames, setMetaData, std::chrono::milliseconds(1000)))
+        {
+            checkEqual(setFrames.size(), size_t(2), context + ", the set size");
+            const int64_t difference = std::abs(static_cast<int64_t>(setMetaData[0].cameraTimestamp - setMetaData[1].cameraTimestamp));
+            check(difference <= std::chrono::nanoseconds(tolerance).count(), context + ", the set timestamps differ by " + std::to_string(difference) + " ns");
+
+            // note, consecutive sets are consecutive frames from each source, i.e. nothing is skipped once the sources are aligned
+            //
+            if (!previous.empty()) for (size_t i = 0; i < 2; i++) checkEqual(setMetaData[i].sequence, previous[i].sequence + 1, context + ", the sequence of source " + std::to_string(i));
+
+            previous = setMetaData;
+            sets++;
+        }
+
+        capture.stop();
+
+        const auto statistics = capture.getStatistics();
+        const uint64_t discarded = (offset == 0) ? 0 : 1;
+        checkEqual(sets, frames - static_cast<int32_t>(discarded), context + ", the number of sets");
+        checkEqual(statistics.completeSets, static_cast<uint64_t>(sets), context + ", the complete sets");
+        checkEqual(statistics.discardedFrames, discarded, context + ", the discarded frames");
+        checkEqual(statistics.droppedFrames, uint64_t(0), context + ", the dropped frames");
+    }
+}
+
+static void testBayerConversion()
+{
+    // the converted frames (grabbed and dispatched) must be identical to cv::cvtColor() of the raw frame, for each bayer pattern and output
+    // note, the pattern is static (smpte), i.e. every frame of the source is the same
+    //
+    for (const std::string pattern : {"gbrg", "rggb", "grbg", "bggr"})
+    {
+        const auto pipeline = createSource(pattern, 320, 240, 8, "pattern=smpte") + " ! appsink";
+
+        auto rawCapture = startCapture(pipeline, GigEVideoCapture::GrabMode::COPY);
+        const auto raw = grabNext(*rawCapture, "pattern " + pattern);
+        const auto format = rawCapture->getFrameFormat();
+        rawCapture->stop();
+
+        for (const auto output : {BayerConverter::Output::BGR, BayerConverter::Output::GRAY})
+        {
+            const auto context = "pattern " + pattern + ((output == BayerConverter::Output::BGR) ? ", BGR" : ", GRAY");
+            auto expected = cv::Mat();
+            cv::cvtColor(raw, expected, BayerConverter::conversionCode(format.bayerPattern, output));
+
+            auto capture = std::make_unique<GigEVideoCapture>(pipeline);
+            capture->setCaptureMode(GigEVideoCapture::CaptureMode::CONTINUOUS);
+            capture->setOutputConversion(output);
+
+            auto dispatched = std::promise<cv::Mat>();
+            auto dispatchedFrame = dispatched.get_future();
+            bool first = true;
+            capture->setFrameCallback([&dispatched, &first](const cv::Mat& frame, const FrameMetaData&) {
+                if (!first) return;
+
+                first = false;
+                dispatched.set_value(frame.clone());
+            });
+
+            check(capture->start(), context + ", unable to start the pipeline");
+            const auto grabbed = grabNext(*capture, context);
+            check(dispatchedFrame.wait_for(GRAB_TIMEOUT) == std::future_status::ready, context + ", no frame was dispatched");
+            const auto subscribed = dispatchedFrame.get();
+
+            // note, destroyed here as the callback references the locals above
+            //
+            capture->stop();
+            capture.reset();
+
+            checkEqual(grabbed.type(), expected.type(), context + ", the grabbed frame type");
+            check(cv::norm(grabbed, expected, cv::NORM_INF) == 0.0, context + ", the grabbed frame differs from cv::cvtColor()");
+            checkEqual(subscribed.type(), expected.type(), context + ", the dispatched frame type");
+            check(cv::norm(subscribed, expected, cv::NORM_INF) == 0.0, context + ", the dispatched frame differs from cv::cvtColor()");
+        }
+    }
+}
+
+static void testTeeChannels()
+{
+    // a tee with two appsinks, the primary (full size) is grabbed as usual and the other (scaled) through its FrameChannel
+    // notes 1, both are grabbed concurrently and neither queue can overflow, i.e. every frame must be delivered exactly once on each
+    //       2, each appsink has its own negotiated frame format
+    //
+    const int32_t frames = 30;
+    const auto pipeline = createSource("GRAY8", 320, 240, frames, "pattern=ball") + " ! tee name=t "
+                          "t. ! queue ! appsink name=analysis "
+                          "t. ! queue ! videoscale ! video/x-raw,width=160,height=120 ! appsink name=display";
+
+    auto capture = GigEVideoCapture(pipeline, "analysis");
+    capture.setCaptureMode(GigEVideoCapture::CaptureMode::CONTINUOUS, frames + 2);
+    check(capture.getChannelNames() == std::vector<std::string>({"display"}), "the channel names, expected only: display");
+
+    auto& display = capture.getChannel("display");
+    auto options = FrameChannel::Options();
+    options.queueDepth = frames + 2;
+    display.setOptions(options);
+    check(capture.start(), "Unable to start the pipeline: " + pipeline);
+
+    const auto grabAll = [](const std::function<bool(cv::Mat&)>& grab, const cv::Size size, const std::string& context) {
+        int32_t grabbed = 0;
+        auto frame = cv::Mat();
+        while (grab(frame))
+        {
+            check((frame.size() == size) && (frame.type() == CV_8UC1), context + ", the frame size or type");
+            grabbed++;
+        }
+
+        return grabbed;
+    };
+
+    auto displayed = std::async(std::launch::async, [&display, &grabAll] {
+        return grabAll([&display](cv::Mat& frame) { return display.tryGrab(frame, std::chrono::milliseconds(1000)); }, cv::Size(160, 120), "channel display");
+    });
+
+    const auto analysed = grabAll([&capture](cv::Mat& frame) { return capture.tryGrab(frame, std::chrono::milliseconds(1000), GigEVideoCapture::GrabPolicy::QUEUED); }, cv::Size(320, 240), "primary");
+    const auto displayedFrames = displayed.get();
+    capture.stop();
+
+    const auto format = display.getFrameFormat();
+    checkEqual(format.width, 160, "the channel's negotiated width");
+    checkEqual(format.height, 120, "the channel's negotiated height");
+    checkEqual(capture.getFrameFormat().width, 320, "the primary's negotiated width");
+
+    const auto statistics = display.getStatistics();
+    checkEqual(analysed, frames, "the primary frame count");
+    checkEqual(displayedFrames, frames, "the channel frame count");
+    checkEqual(statistics.received, static_cast<uint64_t>(frames), "the channel's received frames");
+    checkEqual(statistics.delivered, static_cast<uint64_t>(frames), "the channel's delivered frames");
+    checkEqual(statistics.dropped, uint64_t(0), "the channel's dropped frames");
+    checkEqual(capture.getTelemetry().dropped, uint64_t(0), "the primary's dropped frames");
+}
+
+static void testChangeDetection()
+{
+    // alternating static (smpte) and moving (snow, i.e. every frame differs) segments, concatenated so that the sequence is the same every run
+    // notes 1, the 1st frame of each segment differs from the reference (i.e. the last changed frame) so is delivered, as is every snow frame
+    //          the remaining smpte frames are identical to the reference, i.e. suppressed (SUPPRESS) or delivered with changed false (FLAG)
+    //       2, forcedInterval is 0, so no static frame is forced through
+    //
+    const int32_t segmentFrames = 10;
+    const std::vector<std::string> segments = {"smpte", "snow", "smpte", "snow"};
+
+    auto pipeline = std::string("concat name=c ! appsink");
+    auto expected = std::vector<bool>();
+    for (size_t i = 0; i < segments.size(); i++)
+    {
+        pipeline += " " + createSource("GRAY8", 320, 240, segmentFrames, "pattern=" + segments[i]) + " ! c.";
+        for (int32_t frame = 0; frame < segmentFrames; frame++) expected.emplace_back((frame == 0) || (segments[i] == "snow"));
+    }
+
+    const auto changedFrames = static_cast<int32_t>(std::count(expected.begin(), expected.end(), true));
+    const auto unchangedFrames = static_cast<int32_t>(expected.size()) - changedFrames;
+
+    for (const auto action : {ChangeDetector::Action::SUPPRESS, ChangeDetector::Action::FLAG})
+    {
+        const bool suppress = (action == ChangeDetector::Action::SUPPRESS);
+        const auto context = std::string(suppress ? "SUPPRESS" : "FLAG");
+
+        auto capture = GigEVideoCapture(pipeline);
+        capture.setCaptureMode(GigEVideoCapture::CaptureMode::CONTINUOUS, expected.size() + 2);
+
+        auto options = ChangeDetector::Options();
+        options.enabled = true;
+        options.action = action;
+        options.forcedInterval = 0;
+        capture.setChangeDetection(options);
+        check(capture.start(), context + ", unable to start the pipeline: " + pipeline);
+
+        auto flags = std::vector<bool>();
+        auto frame = cv::Mat();
+        while (capture.tryGrab(frame, std::chrono::milliseconds(1000), GigEVideoCapture::GrabPolicy::QUEUED))
+        {
+            const auto& metaData = capture.getFrameMetaData();
+            check(metaData.changed || (metaData.changeScore < 1.0), context + ", an unchanged frame has the score " + std::to_string(metaData.changeScore));
+            flags.emplace_back(metaData.changed);
+        }
+
+        capture.stop();
+
+        const auto telemetry = capture.getTelemetry();
+        if (suppress)
+        {
+            checkEqual(static_cast<int32_t>(flags.size()), changedFrames, context + ", the delivered frames");
+            check(std::count(flags.begin(), flags.end(), false) == 0, context + ", an unchanged frame was delivered");
+            checkEqual(telemetry.unchanged, static_cast<uint64_t>(unchangedFrames), context + ", the suppressed frames");
+        }
+        else
+        {
+            checkEqual(flags.size(), expected.size(), context + ", the delivered frames");
+            for (size_t i = 0; i < flags.size(); i++) checkEqual(static_cast<bool>(flags[i]), static_cast<bool>(expected[i]), context + ", the change flag of frame " + std::to_string(i));
+            checkEqual(telemetry.unchanged, uint64_t(0), context + ", the suppressed frames");
+        }
+    }
+}
+
+static void testPropertyTransactions()
+{
+    // commits videotestsrc property changes, i.e. stock element properties, while streaming
+    // notes 1, the source is live (i.e. paced at 30 fps) so that the handler() is still receiving frames when the transaction is committed
+    //       2, a transaction with an out of range value or an unknown component is rejected, i.e. no part of it is applied and no generation is created
+    //       3, the frames captured after the pattern change (black to white) are tagged with its generation, those before it with the previous one
+    //
+    const int32_t frames = 60;
+    const auto pipeline = createSource("GRAY8", 160, 120, frames, "name=source is-live=true pattern=black") + " ! appsink";
+    auto capture = startCapture(pipeline, GigEVideoCapture::GrabMode::COPY, frames + 2);
+
+    const auto isWhite = [](const cv::Mat& frame) { return cv::mean(frame)[0] > 192.0; };
+    const auto first = grabNext(*capture, "the 1st frame");
+    check(!isWhite(first), "the 1st frame, expected the black pattern");
+    checkEqual(capture->getFrameMetaData().settingsGeneration, uint64_t(0), "the 1st frame's settings generation");
+
+    const auto commit = [&capture](const PropertyTransaction& transaction) {
+        auto result = capture->commitProperties(transaction);
+        check(result.wait_for(GRAB_TIMEOUT) == std::future_status::ready, "the transaction was not applied");
+        return result.get();
+    };
+
+    auto outOfRange = PropertyTransaction();
+    outOfRange.setString("source", "pattern", "white").setInteger("source", "num-buffers", -5);
+    auto unknownComponent = PropertyTransaction();
+    unknownComponent.setString("source", "pattern", "white").setString("missing", "pattern", "white");
+
+    for (const auto* transaction : {&outOfRange, &unknownComponent})
+    {
+        const auto context = std::string((transaction == &outOfRange) ? "an out of range value" : "an unknown component");
+        const auto rejected = commit(*transaction);
+        check(!rejected.success, context + ", the transaction was not rejected");
+        checkEqual(rejected.generation, uint64_t(0), context + ", the rejected transaction's generation");
+        checkEqual(rejected.errors.size(), size_t(1), context + ", the errors");
+        checkEqual(capture->getSettingsGeneration(), uint64_t(0), context + ", the settings generation");
+    }
+
+    // the frames after the rejected transactions must still be black, i.e. the valid pattern change of each was not applied either
+    //
+    for (int32_t i = 0; i < 3; i++)
+    {
+        const auto frame = grabNext(*capture, "after the rejected transactions");
+        check(!isWhite(frame), "after the rejected transactions, the pattern was changed");
+        checkEqual(capture->getFrameMetaData().settingsGeneration, uint64_t(0), "after the rejected transactions, the settings generation");
+    }
+
+    auto change = PropertyTransaction();
+    change.setString("source", "pattern", "white");
+    const auto applied = commit(change);
+    check(applied.success, "the pattern change was not applied");
+    checkEqual(applied.generation, uint64_t(1), "the pattern change's generation");
+
+    // the queued frames captured before the change are still black, every frame tagged with the new generation is white
+    //
+    bool changed = false;
+    auto frame = cv::Mat();
+    while (capture->tryGrab(frame, std::chrono::milliseconds(1000), GigEVideoCapture::GrabPolicy::QUEUED))
+    {
+        const auto generation = capture->getFrameMetaData().settingsGeneration;
+        check((generation >= 1) || !changed, "a frame's settings generation went backwards");
+        changed = (generation >= 1);
+
+        checkEqual(isWhite(frame), changed, "the pattern of a frame with the settings generation " + std::to_string(generation));
+    }
+
+    capture->stop();
+    check(changed, "no frame was tagged with the pattern change's generation");
+}
+
+static void testTypedCapture()
+{
+    // the compile time pixel formats, i.e. TypedGigEVideoCapture<Gray8> and TypedGigEVideoCapture<BayerGBRG8, BGR8>
+    // notes 1, the typed frames must be identical to those of an untyped capture of the same pipeline (converted using cv::cvtColor() for the bayer format)
+    //       2, a pipeline whose capsfilter can't produce the format throws when the capture is constructed
+    //
+    const int32_t width = 320, height = 240, frames = 4;
+
+    {
+        const auto pipeline = createSource("GRAY8", width, height, frames, "pattern=smpte") + " ! appsink";
+        const auto expected = grabNext(*startCapture(pipeline, GigEVideoCapture::GrabMode::COPY), "Gray8, the untyped frame");
+
+        auto capture = TypedGigEVideoCapture<Gray8>(pipeline);
+        capture.setCaptureMode(GigEVideoCapture::CaptureMode::CONTINUOUS, frames + 2);
+        check(capture.start(), "Gray8, unable to start the pipeline: " + pipeline);
+
+        auto frame = TypedGigEVideoCapture<Gray8>::Frame();
+        check(capture.tryGrab(frame, GRAB_TIMEOUT, GigEVideoCapture::GrabPolicy::QUEUED), "Gray8, no frame was grabbed");
+        capture.stop();
+
+        checkEqual(frame.type(), CV_8UC1, "Gray8, the frame type");
+        checkEqual(frame.type(), TypedGigEVideoCapture<Gray8>::frameType(), "Gray8, the frame type");
+        check(frame.size() == cv::Size(width, height), "Gray8, the frame size");
+        check(cv::norm(frame, expected, cv::NORM_INF) == 0.0, "Gray8, the frame differs from the untyped frame");
+    }
+
+    {
+        const auto pipeline = createSource("gbrg", width, height, frames, "pattern=smpte") + " ! appsink";
+        const auto raw = grabNext(*startCapture(pipeline, GigEVideoCapture::GrabMode::COPY), "BayerGBRG8, the untyped frame");
+        auto expected = cv::Mat();
+        cv::cvtColor(raw, expected, cv::COLOR_BayerGBRG2BGR);
+
+        using Capture = TypedGigEVideoCapture<BayerGBRG8, BGR8>;
+        auto capture = Capture(pipeline);
+        capture.setCaptureMode(GigEVideoCapture::CaptureMode::CONTINUOUS, frames + 2);
+        check(capture.start(), "BayerGBRG8, unable to start the pipeline: " + pipeline);
+
+        auto frame = Capture::Frame();
+        check(capture.tryGrab(frame, GRAB_TIMEOUT, GigEVideoCapture::GrabPolicy::QUEUED), "BayerGBRG8, no frame was grabbed");
+        const auto format = capture.getFrameFormat();
+        capture.stop();
+
+        check(format.isBayer() && (format.bayerPattern == FrameFormat::BayerPattern::GBRG), "BayerGBRG8, the negotiated bayer pattern");
+        checkEqual(frame.type(), CV_8UC3, "BayerGBRG8, the converted frame type");
+        checkEqual(frame.type(), Capture::frameType(), "BayerGBRG8, the converted frame type");
+        check(frame.size() == cv::Size(width, height), "BayerGBRG8, the frame size");
+        check(cv::norm(frame, expected, cv::NORM_INF) == 0.0, "BayerGBRG8, the converted frame differs from cv::cvtColor()");
+    }
+
+    bool rejected = false;
+    try
+    {
+        auto capture = TypedGigEVideoCapture<Gray16>(createSource("GRAY8", width, height, frames) + " ! appsink");
+    }
+    catch (const std::string&)
+    {
+        rejected = true;
+    }
+
+    check(rejected, "Gray16, a GRAY8 pipeline was not rejected");
+}
+
+static const std::vector<Test> tests = {
+    {"formats", testFormats},
+    {"synchronised-sets", testSynchronisedSets},
+    {"bayer-conversion", testBayerConversion},
+    {"tee-channels", testTeeChannels},
+    {"change-detection", testChangeDetection},
+    {"property-transactions", testPropertyTransactions},
+    {"typed-capture", testTypedCapture}
+};
+
+int32_t main(int32_t argc, char* argv[])
+{
+    gst_debug_set_default_threshold(GST_LEVEL_WARNING);
+    gst_init(&argc, &argv);
+
+    auto selected = std::vector<std::string>(argv + 1, argv + argc);
+    const auto isSelected = [&selected](const std::string& name) { return selected.empty() || (std::find(selected.begin(), selected.end(), name) != selected.end()); };
+
+    int32_t failed = 0;
+    for (const auto& test : tests)
+    {
+        if (!isSelected(test.name)) continue;
+
+        try
+        {
+            test.run();
+            std::cout << "PASS " << test.name << "\n";
+        }
+        catch (const std::string& exception)
+        {
+            std::cout << "FAIL " << test.name << ": " << exception << "\n";
+            failed++;
+        }
+    }
+
+    return failed;
+}
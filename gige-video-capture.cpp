@@ -2,14 +2,14 @@
 // (c) Bit Parallel Ltd (Max van Daalen), March 2022
 //
 
+#include <algorithm>
 #include <sstream>
 
-#include <gstmetatcamstatistics.h>
 #include <gst/app/gstappsink.h>
-#include <gst/video/video.h>
-#include <tcamprop.h>
 
 #include "gige-video-capture.hpp"
+#include "mapped-sample.hpp"
+#include "zero-copy-allocator.hpp"
 
 //
 // note, as GigE cameras have high network utilisation it may be necessary to increase the network receiver buffer size, use:
@@ -19,11 +19,8 @@
 //   see, https://www.flir.co.uk/support-center/iis/machine-vision/knowledge-base/lost-ethernet-data-packets-on-linux-systems/
 //
 
-GigEVideoCapture::GigEVideoCapture(const std::string_view pipeline, const int32_t imageBaseType, const int32_t imageChannels)
+GigEVideoCapture::GigEVideoCapture(const std::string_view pipeline, const std::string& primarySink)
 {
-    type = CV_MAKETYPE(imageBaseType, imageChannels);
-    channels = imageChannels;
-
     // expecting a pipeline similar to "tcamsrc ! video/x-bayer,format=gbrg,width=1280,height=960,framerate=30/1 ! tcamautoexposure ! tcamwhitebalance ! appsink"
     //
     GError* err = nullptr;
@@ -35,6 +32,7 @@ GigEVideoCapture::GigEVideoCapture(const std::string_view pipeline, const int32_
     // note, the code below avoids having to specify a name attribute on each of the pipeline elements in order to access them
     //       i.e. source = gst_bin_get_by_name(GST_BIN(gstPipeline), "source");
     //
+    std::vector<std::string> sinkNames;
     GValue pipelineItem = G_VALUE_INIT;
     GstIterator* pipelineIterator = gst_bin_iterate_elements(GST_BIN(gstPipeline));
     bool done = false;
@@ -47,6 +45,13 @@ GigEVideoCapture::GigEVideoCapture(const std::string_view pipeline, const int32_
                 GstElement* element = GST_ELEMENT(g_value_peek_pointer(&pipelineItem));
                 const auto name = std::string(gst_element_get_name(element));
                 pipelineMap[name] = element;
+
+                // note, the (1st) capsfilter is the default for reconfigure(), the appsinks are configured below
+                //
+                const auto factory = std::string(gst_plugin_feature_get_name(GST_PLUGIN_FEATURE(gst_element_get_factory(element))));
+                if ((capsFilter == nullptr) && (factory == "capsfilter")) capsFilter = element;
+                if (factory == "appsink") sinkNames.emplace_back(name);
+
                 g_value_reset(&pipelineItem);
                 break;
             }
@@ -63,37 +68,64 @@ GigEVideoCapture::GigEVideoCapture(const std::string_view pipeline, const int32_
                 done = true;
                 break;
         }
-
-        //
-        // FIXME! 1, extract the width and height from the pipeline and create the grabbedFrame appropriately
-        //        2, remove the the Mat::create() from the handler()
-        //        3, type and channels then no longer need to be properties
-        //
     }
 
     gst_iterator_free(pipelineIterator);
 
-    // finally, configure the appsink pipeline element
-    // notes 1, to notify the pipeline each time it receives a new image
-    //       2, register the handler to be invoked by the above notification
-    //       3, not as tidy, but could add a name attribute to the 'appsink' element and access the element
-    //          i.e. GstElement* sink = gst_bin_get_by_name(GST_BIN(gstPipeline), "sink");
+    // finally, configure the appsink pipeline elements
+    // notes 1, the primary sink is delivered by this class, it is either the named sink, "appsink0" (i.e. the 1st unnamed appsink) or the 1st appsink by name
+    //       2, every other appsink (i.e. the branches of a tee) is delivered independently by its own FrameChannel, see getChannel()
+    //       3, the primary sink notifies the pipeline each time it receives a new image, which invokes the registered handler
+    //       4, disabled sink clock synchronisation for maximum performance
+    //       5, the frame width, height and type are not known until the caps have been negotiated, i.e. after start()
+    //          they are then extracted from the caps of the 1st sample received by the handler(), see updateFrameFormat()
     //
-    try
-    {
-        // FIXME! this is slightly fragile... but OK for the moment
-        //        notes 1, check for a appsink name parameter, if found use it instead of the hard coded value
-        //              2, could use a sink iterator but then you'd have to assume that there would only ever be one of them
-        //              3, disabled sink clock synchronisation for maximum performance
-        //
-        GstElement* sink = pipelineMap.at("appsink0");
-        g_object_set(G_OBJECT(sink), "emit-signals", true, "sync", false, nullptr);
-        g_signal_connect(sink, "new-sample", G_CALLBACK(GigEVideoCapture::handler), this);
-    }
-    catch (const std::out_of_range& exception)
+    std::sort(sinkNames.begin(), sinkNames.end());
+    const auto hasSink = [&sinkNames](const std::string& name) { return std::find(sinkNames.begin(), sinkNames.end(), name) != sinkNames.end(); };
+
+    auto primary = primarySink;
+    if (primary.empty()) primary = hasSink("appsink0") ? "appsink0" : (sinkNames.empty() ? "" : sinkNames.front());
+    if (!hasSink(primary)) throw std::string("Unable to locate the required appsink pipeline element: ") + primary;
+
+    for (const auto& sinkName : sinkNames)
     {
-        throw std::string("Unable to locate the required appsink pipeline element");
+        GstElement* sink = pipelineMap.at(sinkName);
+        if (sinkName == primary)
+        {
+            appSink = sink;
+            g_object_set(G_OBJECT(sink), "emit-signals", true, "sync", false, nullptr);
+            g_signal_connect(sink, "new-sample", G_CALLBACK(GigEVideoCapture::handler), this);
+
+            // every buffer is counted (and the drop policy applied) as it arrives at the appsink, see probe()
+            //
+            GstPad* pad = gst_element_get_static_pad(sink, "sink");
+            gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, GigEVideoCapture::probe, this, nullptr);
+            gst_object_unref(pad);
+        }
+        else
+        {
+            channels.emplace(sinkName, std::make_unique<FrameChannel>(sinkName, sink));
+        }
     }
+
+    setIngestion(IngestOptions());
+
+    // the streaming threads announce themselves on the bus as they start, see busHandler()
+    //
+    GstBus* bus = gst_element_get_bus(gstPipeline);
+    gst_bus_set_sync_handler(bus, GigEVideoCapture::busHandler, this, nullptr);
+    gst_object_unref(bus);
+}
+
+GigEVideoCapture::GigEVideoCapture(const ReplaySource::Options& replay):
+    gstPipeline(nullptr)
+{
+    // plays back a recording (see startRecording()) in place of a pipeline, i.e. for testing without a camera
+    // notes 1, the frame format is known immediately, it is the format that was recorded
+    //       2, there are no pipeline components, so the property setters always fail
+    //
+    replaySource = std::make_unique<ReplaySource>(replay);
+    frameFormat = replaySource->getFrameFormat();
 }
 
 GstFlowReturn GigEVideoCapture::handler(GstElement* sink, gpointer userData)
@@ -103,302 +135,1808 @@ GstFlowReturn GigEVideoCapture::handler(GstElement* sink, gpointer userData)
     // note, preferring the use of a reference, i.e. could just use a pointer (the compiler won't care either way...)
     //
     GigEVideoCapture& instance = *static_cast<GigEVideoCapture*>(userData);
-    GstSample* sample = gst_app_sink_pull_sample(GST_APP_SINK(sink));
+    return instance.ingest(gst_app_sink_pull_sample(GST_APP_SINK(sink)));
+}
+
+GstFlowReturn GigEVideoCapture::ingest(GstSample* sample)
+{
+    // processes each sample pulled from the primary appsink, either by the new-sample handler() or by the puller() thread, see setIngestion()
+    //
+    const auto handlerScope = CaptureTelemetry::Scope(telemetry.handlerLatency);
+    const uint64_t arrivalTime = CaptureTelemetry::now();
+    if (sample)
+    {
+        ingestQueued--;
+        ingestPulled++;
+    }
 
-    if (!instance.doGrab)
+    // any committed property transactions are applied between frames, i.e. this frame was captured using the previous settings
+    //
+    const uint64_t generation = settingsGeneration.load();
+    if (transactionsPending.load()) applyTransactions();
+
+    telemetry.received++;
+    telemetry.recordFirstFrame(arrivalTime);
+
+    const bool continuous = (captureMode == CaptureMode::CONTINUOUS);
+    if (!isFrameRequired())
     {
         // required to correctly discard the sample
         //
         if (sample) gst_sample_unref(sample);
+        telemetry.discarded++;
         return GST_FLOW_OK;
     }
 
-    if (sample)
+    if (!sample)
     {
-        GstBuffer* buffer = gst_sample_get_buffer(sample);
+        telemetry.sampleFailures++;
 
-        GstMapInfo info;
-        if (gst_buffer_map(buffer, &info, GST_MAP_READ))
-        {
-            GstVideoInfo* videoInfo = gst_video_info_new();
-            if (!gst_video_info_from_caps(videoInfo, gst_sample_get_caps(sample)))
-            {
-                // unable to parse video info, this should not happen...
-                //
-                g_warning("Failed to parse video info");
-                gst_buffer_unmap(buffer, &info);
-                gst_video_info_free(videoInfo);
-                gst_sample_unref(sample);
+        // unblock the grab() method
+        // let the user know, as they get back the previous image grab
+        //
+        if (!continuous) notifyGrab(false);
 
-                // unblock the grab() method
-                // let the user know, as they get back the previous image grab
-                //
-                std::scoped_lock<std::mutex> lock(instance.lockMutex);
-                instance.doGrab = false;
-                instance.doGrabSuccess = false;
-                instance.condition.notify_one();
+        // should this return GST_FLOW_OK, not sure...
+        //
+        return GST_FLOW_ERROR;
+    }
 
-                return GST_FLOW_ERROR;
-            }
+    GstBuffer* buffer = gst_sample_get_buffer(sample);
 
-            // notes 1, the pipeline is likely to be configured to generate a bayer GBRG 1 channel image
-            //       2, cv::Mat::create() will return immediately if cv::Size() and type match the existing values
-            //          otherwise it will allocate and initialise, this will happen once during the 1st call to GigEVideoCapture::handler()
-            //
-            instance.grabbedFrame.create(videoInfo->height, videoInfo->width, instance.type);
-            memcpy(instance.grabbedFrame.data, info.data, videoInfo->width * videoInfo->height * instance.channels);
+    GstMapInfo info;
+    if (!gst_buffer_map(buffer, &info, GST_MAP_READ))
+    {
+        telemetry.mapFailures++;
+        gst_sample_unref(sample);
+        if (!continuous) notifyGrab(false);
 
-            // grab the required frame meta data
-            //
-            GstMeta* gstMeta = gst_buffer_get_meta(buffer, g_type_from_name("TcamStatisticsMetaApi"));
-            if (gstMeta)
-            {
-                GstStructure* metaData = ((TcamStatisticsMeta*)gstMeta)->structure;
-                gst_structure_get_uint64(metaData, "camera_time_ns", &(instance.cameraTimestamp));
-                gst_structure_get_double(metaData, "framerate", &(instance.cameraFrameRate));
-            }
+        return GST_FLOW_ERROR;
+    }
 
-            // minimise the required lock scope
-            //
-            {
-                std::scoped_lock<std::mutex> lock(instance.lockMutex);
-                instance.doGrab = false;
-                instance.doGrabSuccess = true;
-                instance.condition.notify_one();
-            }
+    // from here on the sample is unmapped and released when the last reference to it is released
+    // i.e. at the end of this method, or when the last zero copy cv::Mat that references it is released
+    //
+    const auto mappedSample = std::make_shared<MappedSample>(sample, buffer, info);
 
-            // tidy up...
-            //
-            gst_buffer_unmap(buffer, &info);
-            gst_video_info_free(videoInfo);
-            gst_sample_unref(sample);
+    // the caps are only parsed when first negotiated, or if they change, the caps object is otherwise the same for every sample
+    //
+    GstCaps* caps = gst_sample_get_caps(sample);
+    if ((caps != frameCaps) && !updateFrameFormat(caps, info.size))
+    {
+        // unable to parse the caps, i.e. an unsupported format (or not the format required, see restrictFormat())
+        //
+        g_warning("Failed to parse the negotiated caps, the format is not supported");
+        telemetry.capsFailures++;
+        if (!continuous) notifyGrab(false);
+
+        return GST_FLOW_ERROR;
+    }
+
+    // note, the frame is described by a cv::Mat header for the mapped buffer, i.e. nothing is copied here
+    //
+    cv::Mat source;
+    if (!mappedSample->view(frameFormat, source))
+    {
+        g_warning("The mapped buffer is smaller than the negotiated frame size");
+        telemetry.capsFailures++;
+        if (!continuous) notifyGrab(false);
+
+        return GST_FLOW_ERROR;
+    }
+
+    // grab the required frame meta data
+    //
+    FrameMetaData metaData;
+    metaData.sequence = frameSequence++;
+    metaData.arrivalTime = arrivalTime;
+    metaData.settingsGeneration = generation;
+    if (mappedSample->readMetaData(metaData)) telemetry.recordCameraCounters(metaData.cameraFrameCount, metaData.cameraFramesDropped);
+
+    // map the camera timestamp to the host clocks, see ClockCorrelator
+    //
+    if (clockCorrelator.correlate(metaData) && (metaData.transportLatency >= 0)) telemetry.transportLatency.record(metaData.transportLatency);
+
+    deliver(source, metaData, mappedSample);
+    return GST_FLOW_OK;
+}
+
+GstPadProbeReturn GigEVideoCapture::probe(GstPad* pad, GstPadProbeInfo* info, gpointer userData)
+{
+    // runs on the streaming thread as each buffer arrives at the primary appsink, i.e. before it is queued
+    // notes 1, the number of queued buffers is therefore known exactly, so the queue is bounded by the drop policy here rather than by the appsink
+    //       2, DROP_NEWEST drops the arriving buffer, DROP_OLDEST pulls (and releases) the oldest queued sample to make room for it
+    //
+    GigEVideoCapture& instance = *static_cast<GigEVideoCapture*>(userData);
+    instance.ingestArrived++;
+
+    const size_t limit = instance.ingestLimit.load();
+    if ((limit > 0) && (instance.ingestQueued.load() >= static_cast<int64_t>(limit)))
+    {
+        if (instance.ingestDropNewest.load())
+        {
+            instance.ingestDropped++;
+            return GST_PAD_PROBE_DROP;
+        }
 
-            return GST_FLOW_OK;
+        GstSample* oldest = gst_app_sink_try_pull_sample(GST_APP_SINK(instance.appSink), 0);
+        if (oldest != nullptr)
+        {
+            gst_sample_unref(oldest);
+            instance.ingestQueued--;
+            instance.ingestDropped++;
         }
+    }
 
-        gst_sample_unref(sample);
+    // note, only the streaming thread increases the queue, so only it updates the peak
+    //
+    const int64_t queued = ++instance.ingestQueued;
+    if (queued > instance.ingestPeak.load()) instance.ingestPeak.store(queued);
 
-        // unblock the grab() method
-        // let the user know, as they get back the previous image grab
+    return GST_PAD_PROBE_OK;
+}
+
+void GigEVideoCapture::puller()
+{
+    // the PULL_THREAD ingestion, pulls each sample from the primary appsink, i.e. without the per frame signal emission
+    // notes 1, waits (rather than pulling) while the pipeline is not streaming, as the pull would otherwise return immediately
+    //       2, the pull timeout bounds how long stopping the thread can take
+    //
+    const GstClockTime timeout = std::chrono::duration_cast<std::chrono::nanoseconds>(ingestOptions.pullTimeout).count();
+    applyThreadScheduling(ThreadRole::CAPTURE, pthread_self(), "capture");
+
+    while (pulling.load())
+    {
+        // note, busy is set before streaming is checked again, i.e. resetIngestQueue() either sees the puller busy or the puller sees streaming has stopped
         //
-        std::scoped_lock<std::mutex> lock(instance.lockMutex);
-        instance.doGrab = false;
-        instance.doGrabSuccess = false;
-        instance.condition.notify_one();
+        pullerBusy.store(true);
+        if (streaming.load())
+        {
+            GstSample* sample = gst_app_sink_try_pull_sample(GST_APP_SINK(appSink), timeout);
+            if (sample != nullptr) ingest(sample);
+
+            // timed out, unless the pipeline has reached the end of the stream
+            //
+            const bool idle = (sample == nullptr) && gst_app_sink_is_eos(GST_APP_SINK(appSink));
+            pullerBusy.store(false);
+            if (!idle) continue;
+        }
+
+        pullerBusy.store(false);
+
+        std::unique_lock<std::mutex> lock(ingestMutex);
+        ingestCondition.wait_for(lock, ingestOptions.pullTimeout, [this] { return !pulling.load() || streaming.load(); });
     }
-    else
+}
+
+bool GigEVideoCapture::setIngestion(const IngestOptions& options)
+{
+    // selects how the frames are taken from the primary appsink, i.e. the new-sample signal (SIGNAL) or a dedicated capture thread (PULL_THREAD)
+    // notes 1, must be called while the pipeline is not streaming, i.e. before start() or after stop() / prepare()
+    //       2, maxBuffers bounds the appsink queue (0 is unbounded), when full the drop policy is applied, see probe() and getIngestStatistics()
+    //
+    if (replaySource || (appSink == nullptr)) return false;
+    if (streaming.load())
     {
-        // unblock the grab() method
-        // let the user know, as they get back the previous image grab
-        //
-        std::scoped_lock<std::mutex> lock(instance.lockMutex);
-        instance.doGrab = false;
-        instance.doGrabSuccess = false;
-        instance.condition.notify_one();
+        g_warning("GigEVideoCapture::setIngestion() must be called while the pipeline is stopped");
+        return false;
     }
 
-    // should this return GST_FLOW_OK, not sure...
+    stopPuller();
+    ingestOptions = options;
+    ingestLimit.store(options.maxBuffers);
+    ingestDropNewest.store(options.dropPolicy == FrameChannel::DropPolicy::DROP_NEWEST);
+
+    // note, the appsink's own limit is only a backstop, the probe() keeps the queue within maxBuffers
     //
-    return GST_FLOW_ERROR;
+    const bool pull = (options.mode == IngestMode::PULL_THREAD);
+    g_object_set(G_OBJECT(appSink), "emit-signals", !pull, "max-buffers", static_cast<guint>(options.maxBuffers), "drop", (options.maxBuffers > 0), nullptr);
+
+    if (pull)
+    {
+        pulling.store(true);
+        pullThread = std::thread(&GigEVideoCapture::puller, this);
+    }
+
+    return true;
 }
 
-bool GigEVideoCapture::grab(cv::Mat& frame)
+void GigEVideoCapture::stopPuller()
 {
+    if (!pullThread.joinable()) return;
+
     {
-        std::unique_lock<std::mutex> lock(lockMutex);
-        doGrab = true;
-        while (doGrab) condition.wait(lock);
+        std::scoped_lock<std::mutex> lock(ingestMutex);
+        pulling.store(false);
     }
 
-    frame = grabbedFrame;
-    return doGrabSuccess;
+    ingestCondition.notify_all();
+    pullThread.join();
 }
 
-uint64_t GigEVideoCapture::getCameraTimestamp() const
+GigEVideoCapture::IngestOptions GigEVideoCapture::getIngestion() const
 {
-    return cameraTimestamp;
+    return ingestOptions;
 }
 
-double GigEVideoCapture::getCameraFrameRate() const
+GigEVideoCapture::IngestStatistics GigEVideoCapture::getIngestStatistics() const
 {
-    return cameraFrameRate;
+    auto statistics = IngestStatistics();
+    statistics.arrived = ingestArrived.load();
+    statistics.pulled = ingestPulled.load();
+    statistics.dropped = ingestDropped.load();
+    statistics.occupancy = ingestQueued.load();
+    statistics.peakOccupancy = ingestPeak.load();
+
+    return statistics;
 }
 
-bool GigEVideoCapture::start()
+void GigEVideoCapture::setThreadScheduling(const ThreadRole role, const ThreadScheduling& scheduling)
 {
-    if (gst_element_set_state(gstPipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE)
+    // sets the CPU affinity and (optionally) the real time priority of the capture's threads, see ThreadScheduling
+    // notes 1, the STREAMING threads are scheduled as they start, i.e. by the next start(), prepare() or reconfigure() if already running
+    //       2, the CAPTURE and WORKER threads are scheduled immediately if they are already running
+    //       3, any failure is reported using g_warning() and getThreadSchedulingErrors(), the thread then continues with its existing scheduling
+    //       4, once a role has been real time, Policy::OTHER returns its threads to SCHED_OTHER, otherwise the default scheduling leaves them untouched
+    //
     {
-        g_error("GigEVideoCapture::start() failed to set GST_STATE_PLAYING");
-        return false;
+        std::scoped_lock<std::mutex> lock(schedulingMutex);
+        auto& previous = threadScheduling[static_cast<size_t>(role)];
+        if (previous.policy != ThreadScheduling::Policy::OTHER) wasRealTime[static_cast<size_t>(role)] = true;
+        previous = scheduling;
     }
 
-    return waitForStateChange(gstPipeline);
+    if ((role == ThreadRole::CAPTURE) && pullThread.joinable()) applyThreadScheduling(role, pullThread.native_handle(), "capture");
+    FrameDispatcher* frameDispatcher = activeDispatcher.load();
+    if ((role == ThreadRole::WORKER) && frameDispatcher) for (const auto worker : frameDispatcher->getWorkerHandles()) applyThreadScheduling(role, worker, "worker");
 }
 
-bool GigEVideoCapture::stop()
+std::vector<std::string> GigEVideoCapture::getThreadSchedulingErrors() const
 {
-    if (gst_element_set_state(gstPipeline, GST_STATE_NULL) == GST_STATE_CHANGE_FAILURE)
-    {
-        g_error("GigEVideoCapture::stop() failed to set GST_STATE_NULL");
-        return false;
-    }
+    std::scoped_lock<std::mutex> lock(schedulingMutex);
+    return schedulingErrors;
+}
 
-    return waitForStateChange(gstPipeline);
+void GigEVideoCapture::applyThreadScheduling(const ThreadRole role, const pthread_t thread, const std::string& name)
+{
+    std::scoped_lock<std::mutex> lock(schedulingMutex);
+    const ThreadScheduling& scheduling = threadScheduling[static_cast<size_t>(role)];
+    if (scheduling.isDefault() && !wasRealTime[static_cast<size_t>(role)]) return;
+
+    std::string error;
+    if (scheduling.apply(thread, error)) return;
+
+    // note, only the most recent errors are kept
+    //
+    const auto message = "Unable to schedule the " + name + " thread: " + error;
+    g_warning("%s", message.c_str());
+    if (schedulingErrors.size() == 32) schedulingErrors.erase(schedulingErrors.begin());
+    schedulingErrors.emplace_back(message);
 }
 
-bool GigEVideoCapture::setBooleanProperty(const std::string& component, const std::string& name, const bool value)
+GstBusSyncReply GigEVideoCapture::busHandler(GstBus* bus, GstMessage* message, gpointer userData)
 {
-    bool success = false;
-    try
-    {
-        GstElement* element = pipelineMap.at(component);
+    // runs on the thread that posted the message, a stream status ENTER message is posted by a streaming thread as it starts, i.e. it can schedule itself
+    // note, nothing else reads the stream status messages, so they are dropped rather than left on the bus
+    //
+    if (GST_MESSAGE_TYPE(message) != GST_MESSAGE_STREAM_STATUS) return GST_BUS_PASS;
 
-        GValue setValue = G_VALUE_INIT;
-        g_value_init(&setValue, G_TYPE_BOOLEAN);
-        g_value_set_boolean(&setValue, value);
-        success = tcam_prop_set_tcam_property(TCAM_PROP(element), name.c_str(), &setValue);
-        if (!success)
-        {
-            auto message = "Error setting boolean property: " + name + " = " + std::to_string(value) + ", for component: " + component;
-            g_error(message.c_str());
-        }
+    GigEVideoCapture& instance = *static_cast<GigEVideoCapture*>(userData);
+    GstStreamStatusType type;
+    GstElement* owner = nullptr;
+    gst_message_parse_stream_status(message, &type, &owner);
 
-        g_value_unset(&setValue);
-    }
-    catch (const std::out_of_range& exception)
+    if (type == GST_STREAM_STATUS_TYPE_ENTER)
     {
-        auto message = "Pipeline component key \"" + component + "\" does not exist";
-        g_error(message.c_str());
+        const auto name = std::string("streaming (") + ((owner != nullptr) ? GST_OBJECT_NAME(owner) : "unknown") + ")";
+        instance.applyThreadScheduling(ThreadRole::STREAMING, pthread_self(), name);
     }
 
-    return success;
+    return GST_BUS_DROP;
 }
 
-bool GigEVideoCapture::setIntegerProperty(const std::string& component, const std::string& name, const int32_t value)
+bool GigEVideoCapture::isFrameRequired() const
+{
+    // note, when ON_DEMAND the frame is only needed if a grab() or grabBatch() is pending, if there are subscribers or if it is being recorded or published
+    //
+    if (captureMode == CaptureMode::CONTINUOUS) return true;
+
+    const FrameDispatcher* frameDispatcher = activeDispatcher.load();
+    const bool dispatch = frameDispatcher && frameDispatcher->hasSubscribers();
+    return doGrab || batchArmed.load() || dispatch || (activeRecorder.load() != nullptr) || (activePublisher.load() != nullptr);
+}
+
+void GigEVideoCapture::deliver(const cv::Mat& source, const FrameMetaData& capturedMetaData, const std::shared_ptr<void>& owner)
 {
-    bool success = false;
-    try
+    // delivers a captured (or replayed) frame to the recorder, the shared memory publisher, the subscribers and the grab() methods
+    // note, the source frame references memory held by the owner, i.e. the mapped sample or the mapped recording
+    //
+    auto metaData = capturedMetaData;
+    const FrameFormat& format = frameFormat;
+    FrameDispatcher* frameDispatcher = activeDispatcher.load();
+    const bool dispatch = frameDispatcher && frameDispatcher->hasSubscribers();
+    const bool continuous = (captureMode == CaptureMode::CONTINUOUS);
+
+    // the raw frame is recorded before any conversion, see startRecording()
+    // note, recorderUsers is incremented before loading the recorder so that stopRecording() can wait until it is no longer in use
+    //
+    recorderUsers++;
+    FrameRecorder* frameRecorder = activeRecorder.load();
+    if (frameRecorder) frameRecorder->record(source, metaData);
+    recorderUsers--;
+
+    // as is the raw frame published to the other processes, see startPublishing()
+    //
+    publisherUsers++;
+    SharedFramePublisher* framePublisher = activePublisher.load();
+    if (framePublisher) framePublisher->publish(source, metaData);
+    publisherUsers--;
+
+    // the change detection gate, i.e. the frames of a static scene are suppressed (or flagged) before they reach the consumers, see setChangeDetection()
+    // note, a suppressed frame still reaches a pending grabBatch(), i.e. a burst is always of consecutive frames, see below
+    //
+    bool suppressed = false;
+    if (changeDetector.isEnabled())
     {
-        GstElement* element = pipelineMap.at(component);
+        const auto change = changeDetector.detect(source, format);
+        metaData.changed = change.changed;
+        metaData.changeScore = change.score;
+        suppressed = change.suppressed;
+    }
+
+    // the bayer conversion (if any) is not done here, i.e. on the streaming thread, each frame is stored raw and converted by its consumer
+    // i.e. by grab() and grabBatch() on the caller's thread and by the dispatcher's workers, see convertGrabbed() and convertDispatched()
+    //
+    const bool convert = (outputConversion != BayerConverter::Output::NONE) && format.isBayer();
+    const auto pattern = convert ? format.bayerPattern : FrameFormat::BayerPattern::NONE;
+
+    // the views (if any) are produced from each stored frame, a converted frame's views are of the converted frame so are produced by its consumer, see addRegionView()
+    //
+    const bool viewed = !frameViews.empty() && !convert;
+    const bool bayerViews = format.isBayer();
+
+    // the frame statistics (if enabled) are computed by the 1st store of the frame, i.e. before its meta data is stored, see setFrameStatistics()
+    // note, if the frame is copied they are computed in the same pass as the copy, otherwise by a separate pass over the source frame
+    //
+    bool described = !statisticsEnabled.load(std::memory_order_relaxed);
 
-        GValue setValue = G_VALUE_INIT;
-        g_value_init(&setValue, G_TYPE_INT);
-        g_value_set_int(&setValue, value);
-        success = tcam_prop_set_tcam_property(TCAM_PROP(element), name.c_str(), &setValue);
-        if (!success)
+    // computes the statistics (if not yet computed), copying the source frame into the destination in the same pass if given, returns true if copied
+    //
+    const auto describe = [this, &source, &format, &metaData, &described](cv::Mat* destination) {
+        if (described) return false;
+
+        // note, the statistics are pooled, i.e. those of a queued, dispatched or grabbed frame's meta data are never overwritten, see acquireStatistics()
+        //
+        const auto& statistics = acquireStatistics();
+        statisticsKernel(source, format, destination, *statistics);
+        metaData.statistics = statistics;
+        described = true;
+
+        return destination != nullptr;
+    };
+
+    // copies or wraps (i.e. GrabMode::ZERO_COPY) the source frame into the destination frame, returns true if the destination is a zero copy frame
+    //
+    const auto store = [this, &source, &owner, &describe](cv::Mat& destination) {
+        if (describe((grabMode == GrabMode::COPY) ? &destination : nullptr)) return false;
+
+        if (grabMode == GrabMode::ZERO_COPY)
         {
-            auto message = "Error setting integer property: " + name + " = " + std::to_string(value) + ", for component: " + component;
-            g_error(message.c_str());
+            // the frame takes a reference to the owner (i.e. the mapped sample or recording), so no copy is made
+            // note, the previous frame is released here, unless the caller still holds a copy of it
+            //
+            destination = ZeroCopyAllocator::wrap(source.data, source.rows, source.cols, source.type(), source.step, owner);
+            return true;
         }
 
-        g_value_unset(&setValue);
+        // notes 1, the copy will only (re)allocate the destination if its size or type has changed
+        //       2, it copies row by row if the source rows are padded, otherwise it uses a single memcpy(), see copyFrame()
+        //
+        copyKernel(source, destination);
+        return false;
+    };
+
+    // the views of a stored frame
+    // notes 1, the pyramid levels are produced once per frame (from the 1st stored frame) into a pooled set of buffers, which every destination then shares
+    //          a set is only reused once nothing references it, i.e. a queued, dispatched or grabbed frame's levels are never overwritten, see acquireViewSet()
+    //       2, the regions are only headers, so each destination's regions are of its own stored frame
+    //
+    std::vector<cv::Mat>* pyramid = nullptr;
+    const auto generatePyramid = [this, &pyramid](const cv::Mat& frame) {
+        if (pyramid != nullptr) return;
+
+        pyramid = &acquireViewSet();
+        frameViews.generatePyramid(frame, *pyramid);
+    };
+
+    const auto view = [this, &pyramid, &generatePyramid, bayerViews](const cv::Mat& frame, std::vector<cv::Mat>& views) {
+        generatePyramid(frame);
+        views = *pyramid;
+        frameViews.generateRegions(frame, bayerViews, views);
+    };
+
+    // a pending grabBatch() takes each frame until the batch is complete
+    // notes 1, the frame is stored into the next preallocated pool slot, i.e. no allocation and no lock, the lock is only taken to notify the completed batch
+    //       2, as for the recorder, batchUsers is incremented before checking the batch is armed so that grabBatch() can wait until the pool is no longer in use
+    //
+    batchUsers++;
+    if (batchArmed.load())
+    {
+        const size_t index = batchCount.load(std::memory_order_relaxed);
+        if (index < batchTarget)
+        {
+            CapturedFrame& slot = batchPool[index];
+            slot.zeroCopy = store(slot.frame);
+            slot.pattern = pattern;
+            slot.metaData = metaData;
+            batchCount.store(index + 1, std::memory_order_release);
+
+            if ((index + 1) == batchTarget)
+            {
+                std::scoped_lock<std::mutex> lock(lockMutex);
+                batchCondition.notify_one();
+            }
+        }
     }
-    catch (const std::out_of_range& exception)
+    batchUsers--;
+
+    if (suppressed)
     {
-        auto message = "Pipeline component key \"" + component + "\" does not exist";
-        g_error(message.c_str());
+        telemetry.unchanged++;
+        return;
     }
 
-    return success;
-}
+    if (dispatch)
+    {
+        // each dispatched frame must be independent of the next, so this is either a zero copy frame or a newly allocated one
+        // note, as are its views, i.e. the pyramid levels are a pooled set that is not reused until the subscribers have released it
+        //
+        cv::Mat dispatchedFrame;
+        std::vector<cv::Mat> dispatchedViews;
+        store(dispatchedFrame);
+        if (viewed) view(dispatchedFrame, dispatchedViews);
 
-bool GigEVideoCapture::setDoubleProperty(const std::string& component, const std::string& name, const double value)
-{
-    bool success = false;
-    try
+        if (!convert) frameDispatcher->publish(dispatchedFrame, dispatchedViews, metaData);
+        else frameDispatcher->publish(dispatchedFrame, dispatchedViews, metaData, [this, pattern](cv::Mat& frame, std::vector<cv::Mat>& views) { convertDispatched(pattern, frame, views); });
+    }
+
+    if (continuous)
     {
-        GstElement* element = pipelineMap.at(component);
+        CapturedFrame* slot = frameRing->acquireWrite();
+        if (slot == nullptr)
+        {
+            // the consumer has fallen behind and the ring is full, so drop the new frame
+            //
+            telemetry.dropped++;
+            return;
+        }
 
-        GValue setValue = G_VALUE_INIT;
-        g_value_init(&setValue, G_TYPE_DOUBLE);
-        g_value_set_double(&setValue, value);
-        success = tcam_prop_set_tcam_property(TCAM_PROP(element), name.c_str(), &setValue);
-        if (!success)
+        slot->zeroCopy = store(slot->frame);
+        slot->pattern = pattern;
+        if (viewed) view(slot->frame, slot->views);
+        slot->metaData = metaData;
+        frameRing->commitWrite();
+
+        // only take the lock if the consumer is blocked waiting for a frame, i.e. the hot path is lock free
+        // note, the commitWrite() above and the consumerWaiting check below are both sequentially consistent, see waitForFrame()
+        //
+        if (consumerWaiting.load())
         {
-            auto message = "Error setting double property: " + name + " = " + std::to_string(value) + ", for component: " + component;
-            g_error(message.c_str());
+            std::scoped_lock<std::mutex> lock(lockMutex);
+            condition.notify_one();
         }
 
-        g_value_unset(&setValue);
+        return;
     }
-    catch (const std::out_of_range& exception)
-    {
-        auto message = "Pipeline component key \"" + component + "\" does not exist";
-        g_error(message.c_str());
-    }
-
-    return success;
-}
 
-bool GigEVideoCapture::setStringProperty(const std::string& component, const std::string& name, const std::string& value)
-{
-    bool success = false;
-    try
+    if (doGrab)
     {
-        GstElement* element = pipelineMap.at(component);
+        // when a single view is grabbed (see grabView()) only that view is stored, i.e. the rest of the frame is never copied
+        //
+        const int32_t requested = grabRequestedView.load();
+        if (viewed && (requested >= 0) && (static_cast<size_t>(requested) < frameViews.size()))
+        {
+            describe(nullptr);
+            if (frameViews.getKind(requested) == FrameViews::Kind::PYRAMID)
+            {
+                generatePyramid(source);
+                grabbedFrame = (*pyramid)[requested];
+            }
+            else
+            {
+                // note, a zero copy region is a view of the wrapped source frame, i.e. it holds a reference to the owner
+                //
+                frameViews.generateRegions(source, bayerViews, grabbedViews);
+                const cv::Mat& region = grabbedViews[requested];
+                if (region.empty() || (grabMode == GrabMode::COPY)) copyKernel(region, grabbedFrame);
+                else
+                {
+                    cv::Size wholeSize;
+                    cv::Point offset;
+                    region.locateROI(wholeSize, offset);
+                    grabbedFrame = ZeroCopyAllocator::wrap(source.data, source.rows, source.cols, source.type(), source.step, owner)(cv::Rect(offset, region.size()));
+                }
+            }
 
-        GValue setValue = G_VALUE_INIT;
-        g_value_init(&setValue, G_TYPE_STRING);
-        g_value_set_string(&setValue, value.c_str());
-        success = tcam_prop_set_tcam_property(TCAM_PROP(element), name.c_str(), &setValue);
-        if (!success)
+            for (auto& other : grabbedViews) other.release();
+            grabbedView = requested;
+        }
+        else
         {
-            auto message = "Error setting string property: " + name + " = " + value + ", for component: " + component;
-            g_error(message.c_str());
+            // note, the previous grab may have been a pyramid level, i.e. a pooled buffer that must not be copied into
+            //
+            if (grabbedView >= 0) grabbedFrame.release();
+            store(grabbedFrame);
+            if (viewed) view(grabbedFrame, grabbedViews);
+            grabbedView = -1;
         }
 
-        g_value_unset(&setValue);
+        grabbedPattern = pattern;
+        grabbedMetaData = metaData;
+        notifyGrab(true);
     }
-    catch (const std::out_of_range& exception)
+}
+
+const std::shared_ptr<FrameStatistics>& GigEVideoCapture::acquireStatistics()
+{
+    // returns pooled statistics that nothing else references (i.e. no queued, dispatched, grabbed or batched frame's meta data), so that no statistics are allocated
+    // notes 1, the pool is preallocated for the ring (see setCaptureMode()), and otherwise grows to the number of statistics the consumers hold on to
+    //       2, the acquire fence orders the reuse after the release of the last reference, use_count() itself is only a relaxed load
+    //       3, the pool is bounded, once full (i.e. the consumers are keeping the meta data of every frame) the statistics are allocated per frame
+    //
+    for (const auto& statistics : statisticsPool)
     {
-        auto message = "Pipeline component key \"" + component + "\" does not exist";
-        g_error(message.c_str());
+        if (statistics.use_count() == 1)
+        {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return statistics;
+        }
     }
 
-    return success;
+    if (statisticsPool.size() < STATISTICS_POOL) return statisticsPool.emplace_back(std::make_shared<FrameStatistics>());
+
+    unpooledStatistics = std::make_shared<FrameStatistics>();
+    return unpooledStatistics;
 }
 
-std::vector<std::string> GigEVideoCapture::getPipelineComponentNames() const
+std::vector<cv::Mat>& GigEVideoCapture::acquireViewSet()
 {
-    auto names = std::vector<std::string>();
-    for(auto& component : pipelineMap) names.emplace_back(component.first);
+    // returns a set of pyramid buffers that nothing else references (i.e. no queued, dispatched or grabbed frame), so that it is reused without allocating
+    // notes 1, a level that has been added more than once is shared within the set, i.e. its buffer is referenced once per entry
+    //       2, the pool is bounded, once full a set is released (its holders keep their levels) and so is reallocated by cv::resize()
+    //
+    const auto isFree = [](const std::vector<cv::Mat>& set) {
+        for (const auto& level : set)
+        {
+            if (level.empty()) continue;
 
-    return names;
+            const auto entries = std::count_if(set.begin(), set.end(), [&level](const cv::Mat& other) { return other.u == level.u; });
+            if ((level.u == nullptr) || (level.u->refcount != entries)) return false;
+        }
+
+        return true;
+    };
+
+    for (auto& set : viewSets) if (isFree(set)) return set;
+    if (viewSets.size() < VIEW_SETS) return viewSets.emplace_back();
+
+    auto& set = viewSets[nextViewSet++ % viewSets.size()];
+    for (auto& level : set) level.release();
+
+    return set;
 }
 
-bool GigEVideoCapture::waitForStateChange(GstElement* gstPipeline)
+void GigEVideoCapture::replayFrame(const cv::Mat& source, const FrameMetaData& replayedMetaData, const std::shared_ptr<void>& owner)
 {
-    bool success = false;
-    while (!success)
+    // the replay equivalent of the handler(), invoked by the replay thread for each recorded frame
+    //
+    const auto handlerScope = CaptureTelemetry::Scope(telemetry.handlerLatency);
+    const uint64_t arrivalTime = CaptureTelemetry::now();
+    telemetry.received++;
+
+    if (!isFrameRequired())
     {
-        // wait 0.1 seconds for the pipeline to change state
-        //
-        GstState state;
-        GstState pending;
-        const GstStateChangeReturn status = gst_element_get_state(gstPipeline ,&state, &pending, 100000000);
+        telemetry.discarded++;
+        return;
+    }
 
-        if (status == GST_STATE_CHANGE_SUCCESS)
-        {
-            success = true;
-        }
-        else if (status == GST_STATE_CHANGE_FAILURE)
-        {
+    FrameMetaData metaData = replayedMetaData;
+    metaData.sequence = frameSequence++;
+    metaData.arrivalTime = arrivalTime;
+    metaData.settingsGeneration = settingsGeneration.load();
+    deliver(source, metaData, owner);
+}
 
-            std::stringstream ss;
-            ss << "The pipeline failed to change state, details: ";
-            ss << gst_element_state_change_return_get_name(status) << ", ";
-            ss << gst_element_state_get_name(state) << ", ";
-            ss << gst_element_state_get_name(pending);
-            g_error(ss.str().c_str());
-        }
-    }
+void GigEVideoCapture::replayFinished()
+{
+    // unblocks any pending grab() or grabBatch(), i.e. once the recording has been played back they return false rather than waiting forever
+    //
+    std::scoped_lock<std::mutex> lock(lockMutex);
+    replayEnded = true;
+    doGrab = false;
+    doGrabSuccess = false;
+    condition.notify_all();
+    batchCondition.notify_all();
+}
 
-    return success;
+bool GigEVideoCapture::seekReplay(const uint64_t cameraTimestamp)
+{
+    // note, the next frame replayed is the 1st frame recorded at, or after, the camera timestamp
+    //
+    return replaySource && replaySource->seek(cameraTimestamp);
 }
 
-GigEVideoCapture::~GigEVideoCapture()
+void GigEVideoCapture::notifyGrab(const bool success)
+{
+    // unblocks the pending ON_DEMAND grab() method
+    // note, if unsuccessful the user gets back the previous image grab
+    //
+    std::scoped_lock<std::mutex> lock(lockMutex);
+    doGrab = false;
+    doGrabSuccess = success;
+    condition.notify_one();
+}
+
+void GigEVideoCapture::setWorkerPoolSize(const size_t workerCount)
 {
+    // note, must be called before the first subscribe(), the default is one worker per core
+    //
+    workerPoolSize = workerCount;
+}
+
+uint64_t GigEVideoCapture::subscribe(FrameDispatcher::FrameCallback callback, const FrameDispatcher::Options& options, const std::string& view)
+{
+    // notes 1, each captured frame is dispatched (along with its meta data) to the callback using the worker pool
+    //       2, this is independent of the grab() methods, i.e. the frames are delivered regardless of the capture mode
+    //       3, the worker pool is created by the first subscription, it is then published to the handler() using activeDispatcher (as for the recorder)
+    //          i.e. subscribe() may be called while the pipeline is streaming, the dispatcher is never destroyed before the capture
+    //       4, if a view is given (i.e. a region or pyramid level, see addRegionView()) the callback is given that view rather than the whole frame
+    //
+    auto subscriptionOptions = options;
+    subscriptionOptions.view = view.empty() ? -1 : frameViews.find(view);
+    if (!view.empty() && (subscriptionOptions.view < 0)) g_warning("Unknown view: %s, the whole frame will be delivered", view.c_str());
+
+    {
+        std::scoped_lock<std::mutex> lock(dispatcherMutex);
+        if (!dispatcher)
+        {
+            const size_t workerCount = (workerPoolSize > 0) ? workerPoolSize : std::thread::hardware_concurrency();
+            dispatcher = std::make_unique<FrameDispatcher>(workerCount);
+            for (const auto worker : dispatcher->getWorkerHandles()) applyThreadScheduling(ThreadRole::WORKER, worker, "worker");
+            activeDispatcher.store(dispatcher.get());
+        }
+    }
+
+    // note, wrapped so that the delivery latency is recorded, the per subscriber delivery counts are in the subscription statistics
+    //
+    const auto delivery = [this, callback = std::move(callback)](const cv::Mat& frame, const FrameMetaData& metaData) {
+        telemetry.recordDelivery(metaData.sequence, metaData.arrivalTime);
+        callback(frame, metaData);
+    };
+
+    return activeDispatcher.load()->subscribe(delivery, subscriptionOptions);
+}
+
+bool GigEVideoCapture::unsubscribe(const uint64_t id)
+{
+    // note, waits for any running callbacks to return, so must not be called from within the callback
+    //
+    FrameDispatcher* frameDispatcher = activeDispatcher.load();
+    return frameDispatcher && frameDispatcher->unsubscribe(id);
+}
+
+void GigEVideoCapture::setFrameCallback(FrameDispatcher::FrameCallback callback, const FrameDispatcher::Options& options)
+{
+    // a convenience for the common case of a single subscriber, replaces any previously set callback
+    //
+    if (frameCallbackId != 0) unsubscribe(frameCallbackId);
+    frameCallbackId = callback ? subscribe(std::move(callback), options) : 0;
+}
+
+bool GigEVideoCapture::getSubscriptionStatistics(const uint64_t id, FrameDispatcher::Statistics& statistics)
+{
+    FrameDispatcher* frameDispatcher = activeDispatcher.load();
+    return frameDispatcher && frameDispatcher->getStatistics(id, statistics);
+}
+
+bool GigEVideoCapture::startRecording(const std::string& path, const FrameRecorder::Options& options)
+{
+    // notes 1, records every raw frame (i.e. before any bayer conversion) received by the handler(), regardless of the capture mode
+    //       2, returns false if already recording or if the frame format is not yet known, i.e. must be called after the 1st frame has been received
+    //       3, throws if the recording can't be created, see FrameRecorder
+    //       4, the recording stops (dropping frames) if the caps change, as the frame format no longer matches
+    //
+    const auto format = getFrameFormat();
+    if (recorder || !format.isValid()) return false;
+
+    recorder = std::make_unique<FrameRecorder>(path, format, options);
+    hasRecordingStatistics = false;
+    activeRecorder.store(recorder.get());
+
+    return true;
+}
+
+bool GigEVideoCapture::stopRecording()
+{
+    // note, waits for the handler() to finish with the recorder and then flushes the recording and writes its index
+    //
+    if (!recorder) return false;
+
+    activeRecorder.store(nullptr);
+    while (recorderUsers.load() != 0) std::this_thread::yield();
+
+    // note, the final statistics are kept, i.e. so they can still be read by getRecordingStatistics() once stopped
+    //
+    recorder->close();
+    recordingStatistics = recorder->getStatistics();
+    hasRecordingStatistics = true;
+    recorder.reset();
+
+    return true;
+}
+
+bool GigEVideoCapture::getRecordingStatistics(FrameRecorder::Statistics& statistics) const
+{
+    // note, the statistics of the current recording, or of the last recording once it has been stopped, returns false if nothing has been recorded
+    //
+    if (recorder) statistics = recorder->getStatistics();
+    else if (hasRecordingStatistics) statistics = recordingStatistics;
+    else return false;
+
+    return true;
+}
+
+bool GigEVideoCapture::startPublishing(const std::string& name, const SharedFramePublisher::Options& options)
+{
+    // notes 1, publishes every raw frame received by the handler() into a named POSIX shared memory ring, see SharedFrameSubscriber
+    //       2, as for startRecording(), returns false if already publishing or if the frame format is not yet known
+    //       3, throws if the shared memory segment can't be created, see SharedFramePublisher
+    //       4, publishing stops (dropping frames) if the caps change, the subscribers must re-subscribe to a new segment
+    //
+    const auto format = getFrameFormat();
+    if (publisher || !format.isValid()) return false;
+
+    publisher = std::make_unique<SharedFramePublisher>(name, format, options);
+    activePublisher.store(publisher.get());
+
+    return true;
+}
+
+bool GigEVideoCapture::stopPublishing()
+{
+    // note, waits for the handler() to finish with the publisher, the subscribers then see the segment as closed
+    //
+    if (!publisher) return false;
+
+    activePublisher.store(nullptr);
+    while (publisherUsers.load() != 0) std::this_thread::yield();
+
+    publisher.reset();
+    return true;
+}
+
+bool GigEVideoCapture::getPublishingStatistics(SharedFramePublisher::Statistics& statistics) const
+{
+    if (!publisher) return false;
+
+    statistics = publisher->getStatistics();
+    return true;
+}
+
+bool GigEVideoCapture::grab(cv::Mat& frame)
+{
+    return waitForFrame(frame, GrabPolicy::LATEST, nullptr);
+}
+
+bool GigEVideoCapture::grab(cv::Mat& frame, const GrabPolicy policy)
+{
+    return waitForFrame(frame, policy, nullptr);
+}
+
+bool GigEVideoCapture::tryGrab(cv::Mat& frame, const std::chrono::milliseconds timeout, const GrabPolicy policy)
+{
+    return waitForFrame(frame, policy, &timeout);
+}
+
+bool GigEVideoCapture::grabView(const std::string& name, cv::Mat& view, const GrabPolicy policy)
+{
+    // notes 1, grabs the next frame (as for grab()) but only delivers the named view, i.e. in GrabMode::COPY only the view is copied
+    //       2, returns false if there is no such view, the view is empty if its region lies outside the frame
+    //
+    const int32_t index = frameViews.find(name);
+    return (index >= 0) && waitForFrame(view, policy, nullptr, index);
+}
+
+bool GigEVideoCapture::tryGrabView(const std::string& name, cv::Mat& view, const std::chrono::milliseconds timeout, const GrabPolicy policy)
+{
+    const int32_t index = frameViews.find(name);
+    return (index >= 0) && waitForFrame(view, policy, &timeout, index);
+}
+
+bool GigEVideoCapture::getView(const std::string& name, cv::Mat& view) const
+{
+    // note, the named view of the most recently grabbed frame, i.e. by grab() or tryGrab(), it is overwritten by the next grab (as is the frame in GrabMode::COPY)
+    //
+    const int32_t index = frameViews.find(name);
+    if ((index < 0) || (static_cast<size_t>(index) >= frameViewOutputs.size())) return false;
+
+    view = frameViewOutputs[index];
+    return true;
+}
+
+bool GigEVideoCapture::grabBatch(FrameBatch& batch, const size_t count, const std::chrono::milliseconds timeout)
+{
+    // notes 1, arms the handler() to store the next count consecutive frames into the batch pool, then waits for all of them (or the timeout)
+    //       2, intended for hardware triggered bursts, i.e. unlike grab() no frame is missed between one grab and the next
+    //       3, the pool is reused by the next grabBatch(), each pool buffer is swapped with the caller's previous frame buffer (as for grab() in CONTINUOUS)
+    //          i.e. the returned frames are never overwritten by a later batch, a pool buffer still referenced by the caller is reallocated before the batch
+    //       4, in GrabMode::ZERO_COPY each frame holds on to a pipeline buffer, so count must be less than the source's buffer pool size
+    //       5, returns false if fewer than count frames were captured, the frames that were captured are still returned
+    //
+    if (count == 0) return false;
+    if (batchPool.size() < count) batchPool.resize(count);
+
+    // preallocate the pool frames (if not already allocated) so that the handler() does not allocate during the batch
+    // notes 1, only possible once the frame format is known, i.e. after the 1st frame has been received
+    //       2, the pool holds the raw frames, any bayer conversion is done as the batch is returned, see below
+    //       3, a pool buffer that is still referenced (i.e. by a frame the caller kept from a previous batch) is released rather than overwritten
+    //
+    const auto format = getFrameFormat();
+    if (format.isValid() && (grabMode == GrabMode::COPY))
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            if (!isExclusive(batchPool[i].frame)) batchPool[i].frame.release();
+            batchPool[i].frame.create(format.height, format.width, format.type);
+        }
+    }
+
+    // the previous batch's statistics are released, i.e. so that the pool's statistics are reused by this batch rather than more being allocated
+    //
+    for (auto& previous : batch.metaData) previous.statistics.reset();
+
+    {
+        std::unique_lock<std::mutex> lock(lockMutex);
+        if (replayEnded) return false;
+
+        batchTarget = count;
+        batchCount.store(0);
+        batchArmed.store(true);
+
+        // note, the batch has its own condition, i.e. a completed batch can't wake a blocked grab() instead (nor a grab() wake this)
+        //
+        const auto complete = [this] { return (batchCount.load(std::memory_order_acquire) >= batchTarget) || replayEnded; };
+        batchCondition.wait_for(lock, timeout, complete);
+    }
+
+    // disarm, then wait for the handler() to finish with the pool, i.e. if it is storing a frame after the timeout
+    //
+    batchArmed.store(false);
+    while (batchUsers.load() != 0) std::this_thread::yield();
+
+    const size_t captured = std::min(batchCount.load(), count);
+    batch.frames.resize(captured);
+    batch.metaData.resize(captured);
+    batch.missingFrames.clear();
+    batch.discontinuities = 0;
+    batch.cameraFramesDropped = 0;
+
+    for (size_t i = 0; i < captured; i++)
+    {
+        // note, a raw bayer frame is converted here, i.e. on the caller's thread rather than during the burst
+        //
+        CapturedFrame& slot = batchPool[i];
+        if (slot.pattern != FrameFormat::BayerPattern::NONE)
+        {
+            if (!isExclusive(batch.frames[i])) batch.frames[i].release();
+            conversionKernel(slot.frame, slot.pattern, outputConversion, batch.frames[i]);
+            if (slot.zeroCopy) slot.frame.release();
+        }
+        else if (slot.zeroCopy) batch.frames[i] = std::move(slot.frame);
+        else
+        {
+            if (!isExclusive(batch.frames[i])) batch.frames[i].release();
+            std::swap(batch.frames[i], slot.frame);
+        }
+
+        // note, the meta data is moved, i.e. the pool slot no longer holds a reference to the frame's statistics
+        //
+        batch.metaData[i] = std::move(slot.metaData);
+        telemetry.recordDelivery(batch.metaData[i].sequence, batch.metaData[i].arrivalTime);
+        if (i == 0) continue;
+
+        // any gap in the camera frame counts is a range of frames that never reached the handler()
+        // notes 1, the frame counts are zero if not provided by the source, so no gap is detected
+        //       2, a count that doesn't advance (i.e. the camera's counter was reset, or the pipeline reconfigured) is a discontinuity rather than a gap
+        //
+        const FrameMetaData& previous = batch.metaData[i - 1];
+        const FrameMetaData& current = batch.metaData[i];
+        if (current.cameraFrameCount > (previous.cameraFrameCount + 1)) batch.missingFrames.push_back({previous.cameraFrameCount + 1, current.cameraFrameCount - previous.cameraFrameCount - 1});
+        else if ((current.cameraFrameCount <= previous.cameraFrameCount) && (current.cameraFrameCount != 0)) batch.discontinuities++;
+        if (current.cameraFramesDropped > previous.cameraFramesDropped) batch.cameraFramesDropped += current.cameraFramesDropped - previous.cameraFramesDropped;
+    }
+
+    return captured == count;
+}
+
+bool GigEVideoCapture::waitForFrame(cv::Mat& frame, const GrabPolicy policy, const std::chrono::milliseconds* timeout, const int32_t view)
+{
+    // note, the frame is the whole frame (and its views are kept for getView()), or if the view is given (i.e. 0 or more) only that view, see grabView()
+    //
+    if (captureMode == CaptureMode::ON_DEMAND)
+    {
+        {
+            std::unique_lock<std::mutex> lock(lockMutex);
+            if (replayEnded) return false;
+
+            grabRequestedView.store(view);
+            doGrab = true;
+            if (!waitForGrab(lock, timeout))
+            {
+                // timed out, so cancel the grab request
+                //
+                doGrab = false;
+                return false;
+            }
+        }
+
+        // note, when converting (and unsuccessful) the caller's frame is left unchanged, i.e. it is still the previous image grab
+        //
+        if (grabbedPattern != FrameFormat::BayerPattern::NONE)
+        {
+            if (doGrabSuccess) convertGrabbed(grabbedPattern, grabbedFrame, view, frame);
+        }
+        else if (view < 0)
+        {
+            frame = grabbedFrame;
+            frameViewOutputs = grabbedViews;
+        }
+        else if (view == grabbedView) frame = grabbedFrame;
+        else frame.release();
+
+        frameMetaData = grabbedMetaData;
+        if (doGrabSuccess) telemetry.recordDelivery(frameMetaData.sequence, frameMetaData.arrivalTime);
+
+        return doGrabSuccess;
+    }
+
+    // the lock free fast path, i.e. a frame has already been captured
+    //
+    if (readFrame(frame, policy, view)) return true;
+
+    // notes 1, consumerWaiting must be set before re-checking the ring, otherwise the handler() could miss the waiting consumer
+    //       2, the lock is only needed so that the handler() can't notify between the check and the wait
+    //
+    std::unique_lock<std::mutex> lock(lockMutex);
+    consumerWaiting.store(true);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const auto ready = [this] { return !frameRing->empty() || replayEnded; };
+    bool success = true;
+    if (timeout == nullptr) condition.wait(lock, ready);
+    else success = condition.wait_for(lock, *timeout, ready);
+    consumerWaiting.store(false);
+    lock.unlock();
+
+    return success && readFrame(frame, policy, view);
+}
+
+bool GigEVideoCapture::waitForGrab(std::unique_lock<std::mutex>& lock, const std::chrono::milliseconds* timeout)
+{
+    const auto grabbed = [this] { return !doGrab; };
+    if (timeout == nullptr)
+    {
+        condition.wait(lock, grabbed);
+        return true;
+    }
+
+    return condition.wait_for(lock, *timeout, grabbed);
+}
+
+bool GigEVideoCapture::readFrame(cv::Mat& frame, const GrabPolicy policy, const int32_t view)
+{
+    size_t skipped = 0;
+    CapturedFrame* slot = (policy == GrabPolicy::LATEST) ? frameRing->acquireLatest(skipped) : frameRing->acquireRead();
+    if (slot == nullptr) return false;
+
+    // notes 1, when using GrabMode::ZERO_COPY (and no conversion) the slot's reference to the sample is handed over to the caller
+    //       2, otherwise the slot's buffer is swapped with the caller's frame buffer, i.e. the caller takes the frame without a copy
+    //          and the handler() writes a later frame into the caller's previous buffer, see isExclusive()
+    //       3, the frame is only copied out of the slot if the caller's buffer is still referenced elsewhere (or is not owned by OpenCV)
+    //          cv::Mat::copyTo() will reuse the caller's frame buffer if its size and type are unchanged
+    //
+    if (slot->pattern != FrameFormat::BayerPattern::NONE)
+    {
+        // the raw frame is converted here, i.e. on the consumer's thread, the slot's buffer is kept for the next frame unless it is a zero copy frame
+        //
+        convertGrabbed(slot->pattern, slot->frame, view, frame);
+        if (slot->zeroCopy) slot->frame.release();
+    }
+    else if (view >= 0)
+    {
+        // only the view is copied (or handed over), i.e. the rest of the frame is never read, the slot's references are released
+        //
+        cv::Mat empty;
+        cv::Mat& selected = (static_cast<size_t>(view) < slot->views.size()) ? slot->views[view] : empty;
+        // note, a pyramid level is a pooled buffer that is never overwritten while referenced, so is handed over rather than copied
+        //
+        if (slot->zeroCopy || (frameViews.getKind(view) == FrameViews::Kind::PYRAMID))
+        {
+            frame = std::move(selected);
+            if (slot->zeroCopy) slot->frame.release();
+            for (auto& other : slot->views) other.release();
+        }
+        else copyKernel(selected, frame);
+    }
+    else
+    {
+        // note, the previous views are released first, as a region view holds a reference to the caller's previous frame buffer
+        //
+        for (auto& previous : frameViewOutputs) previous.release();
+
+        if (slot->zeroCopy) frame = std::move(slot->frame);
+        else if (frame.empty() || isExclusive(frame)) std::swap(frame, slot->frame);
+        else copyKernel(slot->frame, frame);
+
+        // the views, a copied frame's regions are views of the copy (i.e. located as they were in the slot's frame), the pyramid levels are handed over (see acquireViewSet())
+        // note, the slot's regions are then released, as after the swap they reference the caller's frame, which would otherwise never again be exclusive
+        //
+        frameViewOutputs.resize(slot->views.size());
+        for (size_t i = 0; i < slot->views.size(); i++)
+        {
+            cv::Mat& slotView = slot->views[i];
+            if (slot->zeroCopy || (frameViews.getKind(i) == FrameViews::Kind::PYRAMID)) frameViewOutputs[i] = std::move(slotView);
+            else if (!slotView.empty())
+            {
+                cv::Size wholeSize;
+                cv::Point offset;
+                slotView.locateROI(wholeSize, offset);
+                frameViewOutputs[i] = frame(cv::Rect(offset, slotView.size()));
+                slotView.release();
+            }
+        }
+    }
+
+    frameMetaData = slot->metaData;
+    frameRing->commitRead();
+
+    telemetry.discarded += skipped;
+    telemetry.recordDelivery(frameMetaData.sequence, frameMetaData.arrivalTime);
+
+    return true;
+}
+
+void GigEVideoCapture::convertGrabbed(const FrameFormat::BayerPattern pattern, const cv::Mat& raw, const int32_t view, cv::Mat& frame)
+{
+    // converts a grabbed raw bayer frame on the consumer's thread (i.e. rather than on the streaming thread) and then produces its views
+    // notes 1, the converted frame's buffer is only reused if nothing else references it, i.e. a frame still held by the caller is never overwritten
+    //       2, if only a view is grabbed the whole frame is still converted (into convertedFrame), the view then references it
+    //
+    for (size_t i = 0; i < frameViewOutputs.size(); i++) if ((i >= frameViews.size()) || (frameViews.getKind(i) == FrameViews::Kind::REGION)) frameViewOutputs[i].release();
+
+    cv::Mat& converted = (view < 0) ? frame : convertedFrame;
+    if (!isExclusive(converted)) converted.release();
+    conversionKernel(raw, pattern, outputConversion, converted);
+
+    if (!frameViews.empty()) frameViews.generate(converted, false, frameViewOutputs);
+    if (view < 0) return;
+
+    if (static_cast<size_t>(view) < frameViewOutputs.size()) frame = frameViewOutputs[view];
+    else frame.release();
+}
+
+void GigEVideoCapture::convertDispatched(const FrameFormat::BayerPattern pattern, cv::Mat& frame, std::vector<cv::Mat>& views) const
+{
+    // the dispatcher's preparation of a raw bayer frame, i.e. run once per frame by one of its workers rather than by the streaming thread
+    // note, each dispatched frame must be independent of the next, so the converted frame (and its pyramid levels) are newly allocated
+    //
+    cv::Mat converted;
+    conversionKernel(frame, pattern, outputConversion, converted);
+    frame = converted;
+
+    if (!frameViews.empty()) frameViews.generate(frame, false, views);
+}
+
+bool GigEVideoCapture::isExclusive(const cv::Mat& frame)
+{
+    // returns true if the frame's buffer can be handed over to the handler(), i.e. nothing else can see the handler() write into it
+    // notes 1, allocated by OpenCV's default allocator, i.e. not a zero copy frame or a header for the caller's own memory
+    //       2, not referenced by any other cv::Mat, and the whole buffer rather than a region of it
+    //
+    return (frame.u != nullptr) && (frame.allocator == nullptr) && (frame.u->refcount == 1) && (frame.data == frame.u->data) && (frame.dataend == frame.datalimit);
+}
+
+void GigEVideoCapture::copyFrame(const cv::Mat& source, cv::Mat& destination)
+{
+    // the default frame copy, i.e. the format is only known at runtime, see CopyKernel
+    // note, cv::Mat::copyTo() will only (re)allocate the destination if its size or type has changed
+    //
+    source.copyTo(destination);
+}
+
+void GigEVideoCapture::setGrabMode(const GrabMode mode)
+{
+    // note, should be set before calling start(), the handler() does not synchronise access to the mode
+    //
+    grabMode = mode;
+}
+
+GigEVideoCapture::GrabMode GigEVideoCapture::getGrabMode() const
+{
+    return grabMode;
+}
+
+void GigEVideoCapture::setOutputConversion(const BayerConverter::Output output)
+{
+    // notes 1, should be set before calling start(), the handler() does not synchronise access to the conversion
+    //       2, only applies to bayer frames, any other format is delivered unchanged
+    //       3, the frames are stored raw by the handler() and converted by their consumer, i.e. grab() on the caller's thread and subscribe() on a worker
+    //          so the conversion is never on the streaming thread, and the subscribers' conversions are spread across the worker pool
+    //
+    outputConversion = output;
+}
+
+BayerConverter::Output GigEVideoCapture::getOutputConversion() const
+{
+    return outputConversion;
+}
+
+void GigEVideoCapture::setCaptureMode(const CaptureMode mode, const size_t ringSize)
+{
+    // notes 1, must be set before calling start(), the handler() does not synchronise access to the mode or the ring
+    //       2, when using GrabMode::ZERO_COPY each slot holds on to a pipeline buffer, so the ring size must be less than the source's buffer pool size
+    //
+    captureMode = mode;
+    if (mode == CaptureMode::CONTINUOUS) frameRing = std::make_unique<SpscRing<CapturedFrame>>(ringSize);
+    else frameRing.reset();
+
+    // note, the statistics pool is preallocated for every slot of the ring, and for the grabbed frame, a dispatched frame and the frame being delivered
+    //
+    const size_t preallocated = std::min((frameRing ? frameRing->capacity() : 0) + 3, STATISTICS_POOL);
+    while (statisticsPool.size() < preallocated) statisticsPool.emplace_back(std::make_shared<FrameStatistics>());
+}
+
+GigEVideoCapture::CaptureMode GigEVideoCapture::getCaptureMode() const
+{
+    return captureMode;
+}
+
+void GigEVideoCapture::setFrameStatistics(const bool enabled)
+{
+    // notes 1, when enabled each delivered frame's meta data refers to its mean, histogram, saturation count and bayer channel means, see FrameStatistics
+    //       2, computed in the same pass as the frame copy (GrabMode::COPY), i.e. so the consumer does not need a further pass over the frame
+    //
+    statisticsEnabled.store(enabled);
+}
+
+bool GigEVideoCapture::getFrameStatistics() const
+{
+    return statisticsEnabled.load();
+}
+
+bool GigEVideoCapture::restrictFormat(const std::string& caps, const FormatCheck check, const FrameStatistics::Kernel statistics, const CopyKernel copy, const BayerConverter::Kernel conversion, std::string& error)
+{
+    // restricts the primary appsink to the given caps (i.e. a pixel format), see TypedGigEVideoCapture
+    // notes 1, a pipeline that can't produce the format then fails to negotiate, i.e. on start() rather than as a frame of the wrong type
+    //       2, returns false if the pipeline's capsfilter (if any) can't produce the format, i.e. so that the mismatch is found when the pipeline is constructed
+    //       3, the kernels (if given) replace the frame statistics, frame copy and bayer conversion kernels, i.e. with those specialised for the format
+    //          so that once the format is fixed the frame path has no per frame format dispatch, see FrameStatistics, PixelFormat::copy() and BayerConverter
+    //       4, the check (if given) is applied to each newly negotiated frame format, a format that fails it is an error rather than being delivered
+    //          i.e. the specialised kernels are never given a frame of another type, see updateFrameFormat()
+    //       5, must be called before start(), the handler() does not synchronise access to the kernels
+    //
+    if (replaySource || (appSink == nullptr))
+    {
+        error = "Unable to restrict the format, the capture does not have a pipeline";
+        return false;
+    }
+
+    GstCaps* required = gst_caps_from_string(caps.c_str());
+    if (required == nullptr)
+    {
+        error = "Unable to restrict the format, invalid caps: " + caps;
+        return false;
+    }
+
+    bool compatible = true;
+    if (capsFilter != nullptr)
+    {
+        GstCaps* filtered = nullptr;
+        g_object_get(G_OBJECT(capsFilter), "caps", &filtered, nullptr);
+        if (filtered != nullptr)
+        {
+            compatible = gst_caps_can_intersect(filtered, required);
+            if (!compatible)
+            {
+                gchar* filteredString = gst_caps_to_string(filtered);
+                error = "The pipeline caps: " + std::string(filteredString) + ", can't produce the required format: " + caps;
+                g_free(filteredString);
+            }
+
+            gst_caps_unref(filtered);
+        }
+    }
+
+    if (compatible)
+    {
+        g_object_set(G_OBJECT(appSink), "caps", required, nullptr);
+        formatCheck = check;
+        if (statistics != nullptr) statisticsKernel = statistics;
+        if (copy != nullptr) copyKernel = copy;
+        if (conversion != nullptr) conversionKernel = conversion;
+    }
+
+    gst_caps_unref(required);
+    return compatible;
+}
+
+const FrameMetaData& GigEVideoCapture::getFrameMetaData() const
+{
+    // note, returns the meta data of the most recently grabbed frame
+    //
+    return frameMetaData;
+}
+
+FrameFormat GigEVideoCapture::getFrameFormat()
+{
+    // note, the format is invalid until the 1st frame has been received
+    //
+    std::scoped_lock<std::mutex> lock(lockMutex);
+    return frameFormat;
+}
+
+bool GigEVideoCapture::updateFrameFormat(GstCaps* caps, const size_t bufferSize)
+{
+    // a new caps object with identical content does not need to be parsed again
+    //
+    if ((frameCaps != nullptr) && (caps != nullptr) && gst_caps_is_equal(frameCaps, caps))
+    {
+        gst_caps_unref(frameCaps);
+        frameCaps = gst_caps_ref(caps);
+        return true;
+    }
+
+    auto format = FrameFormat();
+    if (!FrameFormat::fromCaps(caps, format)) return false;
+    format.resolveStride(bufferSize);
+
+    // note, the format must be that required by restrictFormat() (if any), i.e. as the frame kernels are specialised for it
+    //
+    if ((formatCheck != nullptr) && !formatCheck(format))
+    {
+        g_warning("The negotiated format does not match the required pixel format");
+        return false;
+    }
+
+    // note, the lock is only required as the consumer can read the format using getFrameFormat()
+    //
+    {
+        std::scoped_lock<std::mutex> lock(lockMutex);
+        frameFormat = format;
+    }
+
+    if (frameCaps != nullptr) gst_caps_unref(frameCaps);
+    frameCaps = gst_caps_ref(caps);
+
+    return true;
+}
+
+uint64_t GigEVideoCapture::getCameraTimestamp() const
+{
+    return frameMetaData.cameraTimestamp;
+}
+
+uint64_t GigEVideoCapture::getHostTimestamp() const
+{
+    // note, the camera timestamp mapped to CLOCK_MONOTONIC, 0 until the clock correlation has been established
+    //
+    return frameMetaData.hostTimestamp;
+}
+
+double GigEVideoCapture::getCameraFrameRate() const
+{
+    return frameMetaData.cameraFrameRate;
+}
+
+void GigEVideoCapture::setClockCorrelation(const ClockCorrelator::Options& options)
+{
+    // note, restarts the clock correlation, i.e. the fixedLatency should be set to the known exposure, readout and transfer time
+    //
+    clockCorrelator.setOptions(options);
+}
+
+ClockCorrelator::Estimate GigEVideoCapture::getClockEstimate() const
+{
+    return clockCorrelator.getEstimate();
+}
+
+void GigEVideoCapture::setChangeDetection(const ChangeDetector::Options& options)
+{
+    // notes 1, gates the frames delivered to the grab() methods and the subscribers, the recorder and the shared memory publisher still receive every frame
+    //       2, suppressed frames are counted by the telemetry as unchanged, flagged frames are delivered with their meta data's changed set to false
+    //       3, restarts the detection, i.e. the next frame is always delivered and becomes the reference
+    //
+    changeDetector.setOptions(options);
+}
+
+ChangeDetector::Options GigEVideoCapture::getChangeDetection() const
+{
+    return changeDetector.getOptions();
+}
+
+uint64_t GigEVideoCapture::getDroppedFrameCount() const
+{
+    // note, the number of frames dropped by the handler() because the CONTINUOUS capture ring was full
+    //
+    return telemetry.dropped.load();
+}
+
+CaptureTelemetry::Snapshot GigEVideoCapture::getTelemetry() const
+{
+    return telemetry.snapshot();
+}
+
+void GigEVideoCapture::resetTelemetry()
+{
+    telemetry.reset();
+}
+
+void GigEVideoCapture::startTelemetryDump(const std::chrono::milliseconds interval, std::ostream& stream)
+{
+    // note, periodically writes a telemetry snapshot to the stream from a background thread
+    //
+    telemetry.startDump(interval, stream);
+}
+
+void GigEVideoCapture::stopTelemetryDump()
+{
+    telemetry.stopDump();
+}
+
+bool GigEVideoCapture::start()
+{
+    if (replaySource)
+    {
+        {
+            std::scoped_lock<std::mutex> lock(lockMutex);
+            replayEnded = false;
+        }
+
+        const auto frameHandler = [this](const cv::Mat& frame, const FrameMetaData& metaData, const std::shared_ptr<void>& owner) { replayFrame(frame, metaData, owner); };
+        return replaySource->start(frameHandler, [this] { replayFinished(); });
+    }
+
+    // note, a warm start is from PAUSED, see prepare()
+    //
+    GstState state = GST_STATE_NULL;
+    gst_element_get_state(gstPipeline, &state, nullptr, 0);
+    telemetry.startupBegin((state == GST_STATE_PAUSED) ? CaptureTelemetry::Startup::WARM_START : CaptureTelemetry::Startup::COLD_START);
+
+    // note, a failed state change (i.e. an unplugged camera or an unsupported reconfigure()) is reported and returns false, it never aborts
+    //
+    if (!changeState(GST_STATE_PLAYING))
+    {
+        g_warning("GigEVideoCapture::start() failed to set GST_STATE_PLAYING");
+        return false;
+    }
+
+    // note, wakes the puller() thread (if any)
+    //
+    {
+        std::scoped_lock<std::mutex> lock(ingestMutex);
+        streaming.store(true);
+    }
+
+    ingestCondition.notify_all();
+    return true;
+}
+
+bool GigEVideoCapture::prepare()
+{
+    // puts the pipeline into warm standby (PAUSED), i.e. the elements are allocated, the camera is opened and any preroll is complete
+    // notes 1, the following start() then only has to go from PAUSED to PLAYING, see the time to first frame in getTelemetry()
+    //       2, may be used instead of stop() to keep the pipeline warm between captures
+    //       3, no frames are delivered while in standby
+    //
+    if (replaySource)
+    {
+        replaySource->stop();
+        return true;
+    }
+
+    // note, any property transactions still pending are applied even if the state change fails, i.e. so that they are not left waiting
+    //
+    stopStreaming();
+    const bool success = changeState(GST_STATE_PAUSED);
+    applyTransactions();
+    if (!success)
+    {
+        g_warning("GigEVideoCapture::prepare() failed to set GST_STATE_PAUSED");
+        return false;
+    }
+
+    return true;
+}
+
+bool GigEVideoCapture::reconfigure(const std::string& caps, const std::string& component)
+{
+    // renegotiates the caps (i.e. the resolution, format or frame rate) of the existing pipeline, i.e. without rebuilding it
+    // notes 1, sets the caps of the named capsfilter, or by default the pipeline's capsfilter (i.e. the "video/x-bayer,..." in the pipeline description)
+    //       2, if running the pipeline drops to READY (i.e. the source stops streaming) while the caps are changed, and then returns to its previous state
+    //       3, the handler() updates the frame format when the 1st frame with the new caps arrives, the grab and ring frames are reused if their size is unchanged
+    //          otherwise they are reallocated once, an active recording drops the frames with the new format
+    //       4, if the pipeline can't return to its previous state with the new caps (i.e. the source doesn't support them) the previous caps are restored
+    //          false is returned in either case, if even the previous caps fail the pipeline is left stopped (READY or failed), i.e. use stop() and start()
+    //
+    GstElement* filter = capsFilter;
+    const auto named = pipelineMap.find(component);
+    if (!component.empty()) filter = (named != pipelineMap.end()) ? named->second : nullptr;
+
+    if (replaySource || (filter == nullptr))
+    {
+        g_warning("Unable to reconfigure, the pipeline does not have the capsfilter: %s", component.c_str());
+        return false;
+    }
+
+    GstCaps* newCaps = gst_caps_from_string(caps.c_str());
+    if (newCaps == nullptr)
+    {
+        g_warning("Unable to reconfigure, invalid caps: %s", caps.c_str());
+        return false;
+    }
+
+    GstState state = GST_STATE_NULL;
+    gst_element_get_state(gstPipeline, &state, nullptr, 0);
+    const bool active = (state == GST_STATE_PAUSED) || (state == GST_STATE_PLAYING);
+    if (active)
+    {
+        stopStreaming();
+        if (!changeState(GST_STATE_READY))
+        {
+            g_warning("Unable to reconfigure, the pipeline failed to set GST_STATE_READY, the caps are unchanged");
+            gst_caps_unref(newCaps);
+            applyTransactions();
+            return false;
+        }
+
+        resetIngestQueue();
+    }
+
+    GstCaps* previousCaps = nullptr;
+    g_object_get(G_OBJECT(filter), "caps", &previousCaps, nullptr);
+    g_object_set(G_OBJECT(filter), "caps", newCaps, nullptr);
+    gst_caps_unref(newCaps);
+    if (!active)
+    {
+        if (previousCaps != nullptr) gst_caps_unref(previousCaps);
+        return true;
+    }
+
+    if (state == GST_STATE_PLAYING) telemetry.startupBegin(CaptureTelemetry::Startup::RECONFIGURE);
+    const bool success = changeState(state);
+    bool restored = false;
+    if (!success && (previousCaps != nullptr))
+    {
+        g_warning("Unable to reconfigure, the pipeline failed with the caps: %s, restoring the previous caps", caps.c_str());
+        g_object_set(G_OBJECT(filter), "caps", previousCaps, nullptr);
+        restored = changeState(GST_STATE_READY) && changeState(state);
+    }
+
+    if (previousCaps != nullptr) gst_caps_unref(previousCaps);
+    {
+        std::scoped_lock<std::mutex> lock(ingestMutex);
+        streaming.store((success || restored) && (state == GST_STATE_PLAYING));
+    }
+
+    // note, the transactions queued before the caps change are applied now unless the pipeline is streaming again, i.e. in which case the handler() applies them
+    //
+    if (!streaming.load()) applyTransactions();
+
+    ingestCondition.notify_all();
+    return success;
+}
+
+bool GigEVideoCapture::stop()
+{
+    if (replaySource)
+    {
+        replaySource->stop();
+        return true;
+    }
+
+    // note, any property transactions still pending are applied once stopped (or if the state change fails), i.e. so that they are not left waiting
+    //
+    stopStreaming();
+    const bool success = changeState(GST_STATE_NULL);
+    applyTransactions();
+    if (!success)
+    {
+        g_warning("GigEVideoCapture::stop() failed to set GST_STATE_NULL");
+        return false;
+    }
+
+    resetIngestQueue();
+    return true;
+}
+
+bool GigEVideoCapture::setBooleanProperty(const std::string& component, const std::string& name, const bool value)
+{
+    return setProperty(component, name, PropertyTransaction::Value(value));
+}
+
+bool GigEVideoCapture::setIntegerProperty(const std::string& component, const std::string& name, const int32_t value)
+{
+    return setProperty(component, name, PropertyTransaction::Value(value));
+}
+
+bool GigEVideoCapture::setDoubleProperty(const std::string& component, const std::string& name, const double value)
+{
+    return setProperty(component, name, PropertyTransaction::Value(value));
+}
+
+bool GigEVideoCapture::setStringProperty(const std::string& component, const std::string& name, const std::string& value)
+{
+    return setProperty(component, name, PropertyTransaction::Value(value));
+}
+
+bool GigEVideoCapture::setProperty(const std::string& component, const std::string& name, const PropertyTransaction::Value& value)
+{
+    // notes 1, applied immediately on the caller's thread, see commitProperties() for changes that are synchronised with the frames
+    //       2, a failure is reported as a warning (i.e. it is not fatal) and false is returned
+    //
+    auto property = PropertySchema::Property();
+    GValue converted = G_VALUE_INIT;
+    std::string error;
+    bool success = propertySchema.resolve(component, name, property, error) && PropertySchema::convert(property, value, converted, error);
+    if (success)
+    {
+        success = PropertySchema::apply(property, converted, error);
+        g_value_unset(&converted);
+    }
+
+    if (!success) g_warning("%s", error.c_str());
+    return success;
+}
+
+std::future<PropertyTransaction::Result> GigEVideoCapture::commitProperties(const PropertyTransaction& transaction)
+{
+    // notes 1, every change is resolved and converted here (on the caller's thread), if any of them fail the transaction is rejected and nothing is applied
+    //       2, the changes are then applied together by the handler() (on the streaming thread) between two frames
+    //          the frames captured after the transaction was applied are tagged with its generation, see FrameMetaData
+    //       3, if the pipeline is not streaming (i.e. before start()) the changes are applied immediately
+    //       4, some camera properties (i.e. exposure) may take effect a frame or more after they were applied, this depends on the camera
+    //
+    auto pending = std::make_unique<PendingTransaction>();
+    auto result = pending->promise.get_future();
+
+    const auto& changes = transaction.getChanges();
+    pending->properties.reserve(changes.size());
+    pending->values.reserve(changes.size());
+
+    auto rejected = PropertyTransaction::Result();
+    for (const auto& change : changes)
+    {
+        auto property = PropertySchema::Property();
+        GValue value = G_VALUE_INIT;
+        std::string error;
+        if (propertySchema.resolve(change.component, change.name, property, error) && PropertySchema::convert(property, change.value, value, error))
+        {
+            pending->properties.emplace_back(property);
+            pending->values.emplace_back(value);
+        }
+        else
+        {
+            rejected.errors.emplace_back(error);
+        }
+    }
+
+    if (!rejected.errors.empty())
+    {
+        pending->promise.set_value(rejected);
+        return result;
+    }
+
+    // note, streaming is checked under the lock, i.e. stopStreaming() can't clear it between the check and the transaction being queued
+    //
+    {
+        std::scoped_lock<std::mutex> lock(transactionMutex);
+        if (streaming.load())
+        {
+            pendingTransactions.emplace_back(std::move(pending));
+            transactionsPending.store(true);
+            return result;
+        }
+    }
+
+    applyTransaction(*pending);
+    return result;
+}
+
+uint64_t GigEVideoCapture::getSettingsGeneration() const
+{
+    return settingsGeneration.load();
+}
+
+void GigEVideoCapture::stopStreaming()
+{
+    // the handler() no longer applies the queued property transactions once this returns, the caller must apply them, see applyTransactions()
+    // note, cleared under the transaction lock so that commitProperties() either queues its transaction before this or applies it immediately
+    //
+    std::scoped_lock<std::mutex> lock(transactionMutex);
+    streaming.store(false);
+}
+
+void GigEVideoCapture::resetIngestQueue()
+{
+    // the appsink's queue has been flushed (i.e. the pipeline is READY or NULL, so the probe() and the handler() are no longer running)
+    // note, the count is only reset once the puller() has finished with any sample it had already pulled, i.e. that sample is never counted twice
+    //
+    while (pullerBusy.load()) std::this_thread::yield();
+    ingestQueued.store(0);
+}
+
+void GigEVideoCapture::applyTransactions()
+{
+    // note, the lock is only held to take the pending transactions, they are applied without it
+    //
+    std::vector<std::unique_ptr<PendingTransaction>> transactions;
+    {
+        std::scoped_lock<std::mutex> lock(transactionMutex);
+        transactions.swap(pendingTransactions);
+        transactionsPending.store(false);
+    }
+
+    for (auto& transaction : transactions) applyTransaction(*transaction);
+}
+
+void GigEVideoCapture::applyTransaction(PendingTransaction& transaction)
+{
+    auto result = PropertyTransaction::Result();
+    for (size_t i = 0; i < transaction.properties.size(); i++)
+    {
+        std::string error;
+        if (!PropertySchema::apply(transaction.properties[i], transaction.values[i], error)) result.errors.emplace_back(error);
+    }
+
+    result.success = result.errors.empty();
+    result.generation = settingsGeneration.fetch_add(1) + 1;
+    transaction.promise.set_value(result);
+}
+
+GigEVideoCapture::PendingTransaction::~PendingTransaction()
+{
+    for (auto& value : values) g_value_unset(&value);
+}
+
+FrameChannel& GigEVideoCapture::getChannel(const std::string& name)
+{
+    // note, the channel of an additional appsink, i.e. not the primary sink, see the constructor
+    //
+    const auto channel = channels.find(name);
+    if (channel == channels.end()) throw std::string("Pipeline appsink channel \"") + name + "\" does not exist";
+
+    return *channel->second;
+}
+
+std::vector<std::string> GigEVideoCapture::getChannelNames() const
+{
+    auto names = std::vector<std::string>();
+    for (auto& channel : channels) names.emplace_back(channel.first);
+
+    return names;
+}
+
+bool GigEVideoCapture::addRegionView(const std::string& name, const cv::Rect& region)
+{
+    // notes 1, must be added before calling start(), the handler() does not synchronise access to the views
+    //       2, the region is in the delivered frame's coordinates (i.e. after any conversion) and is clipped to the frame, see FrameViews
+    //
+    std::string error;
+    if (frameViews.addRegion(name, region, error)) return true;
+
+    g_warning("%s", error.c_str());
+    return false;
+}
+
+bool GigEVideoCapture::addPyramidView(const std::string& name, const int32_t level)
+{
+    // note, as for addRegionView(), the level is from 1 (half resolution) to 4 (a 16th)
+    //
+    std::string error;
+    if (frameViews.addPyramidLevel(name, level, error)) return true;
+
+    g_warning("%s", error.c_str());
+    return false;
+}
+
+void GigEVideoCapture::clearViews()
+{
+    frameViews.clear();
+}
+
+std::vector<std::string> GigEVideoCapture::getViewNames() const
+{
+    return frameViews.getNames();
+}
+
+std::vector<std::string> GigEVideoCapture::getPipelineComponentNames() const
+{
+    auto names = std::vector<std::string>();
+    for(auto& component : pipelineMap) names.emplace_back(component.first);
+
+    return names;
+}
+
+bool GigEVideoCapture::changeState(const GstState state)
+{
+    // any messages left on the bus (i.e. from a previous state change) are discarded, so that they can't be mistaken for this state change
+    // note, nothing else reads the pipeline bus
+    //
+    GstBus* bus = gst_element_get_bus(gstPipeline);
+    for (GstMessage* message = gst_bus_pop(bus); message != nullptr; message = gst_bus_pop(bus)) gst_message_unref(message);
+
+    // notes 1, NO_PREROLL is returned when a live source (i.e. tcamsrc) goes to PAUSED, it is complete as a live source can't preroll
+    //       2, ASYNC is returned when the sinks must preroll, the change completes once the pipeline posts its state changed message
+    //
+    const GstStateChangeReturn status = gst_element_set_state(gstPipeline, state);
+    bool success = (status == GST_STATE_CHANGE_SUCCESS) || (status == GST_STATE_CHANGE_NO_PREROLL);
+    if (status == GST_STATE_CHANGE_ASYNC) success = waitForStateChange(bus, state);
+
+    gst_object_unref(bus);
+    return success;
+}
+
+bool GigEVideoCapture::waitForStateChange(GstBus* bus, const GstState state)
+{
+    // waits (i.e. blocks on the bus, rather than polling) for the pipeline to post that it has reached the state, or for an error
+    // note, the pipeline's elements post their own state changed messages, these are ignored
+    //
+    const GstClockTime deadline = gst_util_get_timestamp() + STATE_CHANGE_TIMEOUT;
+    for (GstClockTime now = gst_util_get_timestamp(); now < deadline; now = gst_util_get_timestamp())
+    {
+        GstMessage* message = gst_bus_timed_pop_filtered(bus, deadline - now, static_cast<GstMessageType>(GST_MESSAGE_STATE_CHANGED | GST_MESSAGE_ERROR));
+        if (message == nullptr) continue;
+
+        bool done = false, success = false;
+        if (GST_MESSAGE_TYPE(message) == GST_MESSAGE_ERROR)
+        {
+            GError* error = nullptr;
+            gchar* details = nullptr;
+            gst_message_parse_error(message, &error, &details);
+
+            std::stringstream ss;
+            ss << "The pipeline failed to change state to " << gst_element_state_get_name(state) << ", reason: " << ((error != nullptr) ? error->message : "unknown");
+            if (details != nullptr) ss << ", details: " << details;
+            g_warning("%s", ss.str().c_str());
+
+            g_clear_error(&error);
+            g_free(details);
+            done = true;
+        }
+        else if (GST_MESSAGE_SRC(message) == GST_OBJECT(gstPipeline))
+        {
+            GstState previous, current, pending;
+            gst_message_parse_state_changed(message, &previous, &current, &pending);
+            done = success = (current == state);
+        }
+
+        gst_message_unref(message);
+        if (done) return success;
+    }
+
+    g_warning("Timed out waiting for the pipeline to change state to %s", gst_element_state_get_name(state));
+    return false;
+}
+
+GigEVideoCapture::~GigEVideoCapture()
+{
+    if (replaySource) replaySource->stop();
+    stopPuller();
+    stopRecording();
+    stopPublishing();
+    channels.clear();
+    if (frameCaps != nullptr) gst_caps_unref(frameCaps);
+
     // note, this will also free all of the allocated pipeline elements
     //
-    gst_object_unref(gstPipeline);
+    if (gstPipeline != nullptr) gst_object_unref(gstPipeline);
 }
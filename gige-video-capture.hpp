@@ -5,52 +5,330 @@
 #ifndef H_GIGE_VIDEO_CAPTURE
 #define H_GIGE_VIDEO_CAPTURE
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <condition_variable>
+#include <future>
+#include <iostream>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
 #include <gst/gst.h>
 #include <opencv2/opencv.hpp>
 
+#include "bayer-converter.hpp"
+#include "capture-telemetry.hpp"
+#include "change-detector.hpp"
+#include "clock-correlator.hpp"
+#include "frame-batch.hpp"
+#include "frame-channel.hpp"
+#include "frame-dispatcher.hpp"
+#include "frame-format.hpp"
+#include "frame-meta-data.hpp"
+#include "frame-recorder.hpp"
+#include "frame-statistics.hpp"
+#include "frame-views.hpp"
+#include "property-schema.hpp"
+#include "property-transaction.hpp"
+#include "replay-source.hpp"
+#include "shared-frame-publisher.hpp"
+#include "spsc-ring.hpp"
+#include "thread-scheduling.hpp"
+
 class GigEVideoCapture
 {
+    public:
+        // notes 1, COPY, each grabbed frame is copied into an internal buffer that is shared with the caller
+        //          i.e. the next grab() will overwrite the pixels of any previously returned frame
+        //          in CaptureMode::CONTINUOUS the caller's frame buffer is exchanged with the ring's buffer, i.e. it is written by the handler() after the next grab()
+        //       2, ZERO_COPY, each grabbed frame directly references the mapped GstBuffer, which is held until the last cv::Mat copy is released
+        //          i.e. the returned frames are independent and should be treated as read only, holding too many of them will starve the pipeline buffer pool
+        //          when replaying, the frames reference the recording's private (copy on write) mapping, see ReplaySource
+        //
+        enum class GrabMode { COPY, ZERO_COPY };
+
+        // notes 1, ON_DEMAND, the handler() discards every frame unless a grab() is pending, i.e. grab() waits for the next frame
+        //       2, CONTINUOUS, the handler() stores every frame into a ring of preallocated frames, if the ring is full the new frame is dropped
+        //
+        enum class CaptureMode { ON_DEMAND, CONTINUOUS };
+
+        // notes 1, LATEST, returns the newest captured frame and discards any older ones, only waits if no new frame has been captured
+        //       2, QUEUED, returns the captured frames in FIFO order, i.e. no captured frame is discarded by the consumer
+        //       3, only applicable when using CaptureMode::CONTINUOUS
+        //
+        enum class GrabPolicy { LATEST, QUEUED };
+
+        // notes 1, SIGNAL, the appsink emits a new-sample signal for each frame, handled on the gstreamer streaming thread
+        //       2, PULL_THREAD, a dedicated capture thread pulls each frame, i.e. without the per frame signal emission and marshalling
+        //
+        enum class IngestMode { SIGNAL, PULL_THREAD };
+
+        // notes 1, STREAMING, the gstreamer streaming threads (i.e. the source's thread that runs the handler() and those of any queue elements)
+        //       2, CAPTURE, the PULL_THREAD ingestion thread, see setIngestion()
+        //       3, WORKER, the subscriber worker pool, see subscribe()
+        //
+        enum class ThreadRole { STREAMING, CAPTURE, WORKER };
+
+        // the frame copy, i.e. the default is cv::Mat::copyTo() and TypedGigEVideoCapture installs the copy specialised for its format, see PixelFormat::copy()
+        //
+        using CopyKernel = void (*)(const cv::Mat& source, cv::Mat& destination);
+
+        // the negotiated frame format check, i.e. TypedGigEVideoCapture installs its format's PixelFormat::matches(), see restrictFormat()
+        //
+        using FormatCheck = bool (*)(const FrameFormat& format);
+
+        struct IngestOptions
+        {
+            IngestMode mode = IngestMode::SIGNAL;
+            size_t maxBuffers = 4;
+            FrameChannel::DropPolicy dropPolicy = FrameChannel::DropPolicy::DROP_OLDEST;
+            std::chrono::milliseconds pullTimeout = std::chrono::milliseconds(100);
+        };
+
+        // notes 1, arrived, every buffer that reached the primary appsink, pulled, every sample taken from its queue
+        //       2, dropped, buffers dropped by the drop policy as the queue was full
+        //       3, occupancy, the number of buffers currently queued, peakOccupancy the most ever queued
+        //
+        struct IngestStatistics
+        {
+            uint64_t arrived = 0;
+            uint64_t pulled = 0;
+            uint64_t dropped = 0;
+            size_t occupancy = 0;
+            size_t peakOccupancy = 0;
+        };
+
     private:
+        static constexpr GstClockTime STATE_CHANGE_TIMEOUT = 10 * GST_SECOND;
+        static constexpr size_t VIEW_SETS = 16;
+        static constexpr size_t STATISTICS_POOL = 64;
+
+        struct CapturedFrame
+        {
+            cv::Mat frame;
+            std::vector<cv::Mat> views;
+            FrameMetaData metaData;
+            bool zeroCopy = false;
+            FrameFormat::BayerPattern pattern = FrameFormat::BayerPattern::NONE;
+        };
+
+        // a committed transaction, resolved and converted and waiting to be applied by the handler()
+        //
+        struct PendingTransaction
+        {
+            std::vector<PropertySchema::Property> properties;
+            std::vector<GValue> values;
+            std::promise<PropertyTransaction::Result> promise;
+
+            ~PendingTransaction();
+        };
+
         GstElement* gstPipeline;
         std::unordered_map<std::string, GstElement*> pipelineMap;
+        GstElement* capsFilter = nullptr;
+        std::map<std::string, std::unique_ptr<FrameChannel>> channels;
+        GstElement* appSink = nullptr;
+        IngestOptions ingestOptions;
+        std::thread pullThread;
+        std::atomic<bool> pulling = false;
+        std::atomic<bool> pullerBusy = false;
+        std::mutex ingestMutex;
+        std::condition_variable ingestCondition;
+        std::atomic<size_t> ingestLimit = 0;
+        std::atomic<bool> ingestDropNewest = false;
+        std::atomic<uint64_t> ingestArrived = 0;
+        std::atomic<uint64_t> ingestPulled = 0;
+        std::atomic<uint64_t> ingestDropped = 0;
+        std::atomic<int64_t> ingestQueued = 0;
+        std::atomic<int64_t> ingestPeak = 0;
+        std::array<ThreadScheduling, 3> threadScheduling;
+        std::array<bool, 3> wasRealTime = {};
+        std::vector<std::string> schedulingErrors;
+        mutable std::mutex schedulingMutex;
+        PropertySchema propertySchema = PropertySchema(pipelineMap);
+        std::vector<std::unique_ptr<PendingTransaction>> pendingTransactions;
+        std::mutex transactionMutex;
+        std::atomic<bool> transactionsPending = false;
+        std::atomic<uint64_t> settingsGeneration = 0;
+        std::atomic<bool> streaming = false;
+        std::atomic<bool> statisticsEnabled = false;
+        FrameStatistics::Kernel statisticsKernel = &FrameStatistics::compute;
+        FormatCheck formatCheck = nullptr;
+        CopyKernel copyKernel = &GigEVideoCapture::copyFrame;
+        BayerConverter::Kernel conversionKernel = &BayerConverter::convert;
+        std::vector<std::shared_ptr<FrameStatistics>> statisticsPool;
+        std::shared_ptr<FrameStatistics> unpooledStatistics;
 
-        int32_t type, channels;
+        FrameFormat frameFormat;
+        GstCaps* frameCaps = nullptr;
+        GrabMode grabMode = GrabMode::COPY;
+        BayerConverter::Output outputConversion = BayerConverter::Output::NONE;
+        CaptureMode captureMode = CaptureMode::ON_DEMAND;
         cv::Mat grabbedFrame = cv::Mat();
-        uint64_t cameraTimestamp = 0;
-        double cameraFrameRate = 0.0;
+        std::vector<cv::Mat> grabbedViews;
+        std::atomic<int32_t> grabRequestedView = -1;
+        int32_t grabbedView = -1;
+        FrameFormat::BayerPattern grabbedPattern = FrameFormat::BayerPattern::NONE;
+        cv::Mat convertedFrame;
+        FrameMetaData grabbedMetaData;
+        FrameMetaData frameMetaData;
+        FrameViews frameViews;
+        std::vector<cv::Mat> frameViewOutputs;
+        std::vector<std::vector<cv::Mat>> viewSets;
+        size_t nextViewSet = 0;
+        uint64_t frameSequence = 0;
+        std::unique_ptr<SpscRing<CapturedFrame>> frameRing;
+        std::atomic<bool> consumerWaiting = false;
+        CaptureTelemetry telemetry;
+        ClockCorrelator clockCorrelator;
+        ChangeDetector changeDetector;
+        std::unique_ptr<FrameDispatcher> dispatcher;
+        std::atomic<FrameDispatcher*> activeDispatcher = nullptr;
+        std::mutex dispatcherMutex;
+        size_t workerPoolSize = 0;
+        uint64_t frameCallbackId = 0;
+        std::unique_ptr<FrameRecorder> recorder;
+        std::atomic<FrameRecorder*> activeRecorder = nullptr;
+        std::atomic<uint32_t> recorderUsers = 0;
+        FrameRecorder::Statistics recordingStatistics;
+        bool hasRecordingStatistics = false;
+        std::unique_ptr<SharedFramePublisher> publisher;
+        std::atomic<SharedFramePublisher*> activePublisher = nullptr;
+        std::atomic<uint32_t> publisherUsers = 0;
+        std::unique_ptr<ReplaySource> replaySource;
+        std::vector<CapturedFrame> batchPool;
+        size_t batchTarget = 0;
+        std::atomic<size_t> batchCount = 0;
+        std::atomic<bool> batchArmed = false;
+        std::atomic<uint32_t> batchUsers = 0;
+        bool replayEnded = false;
         bool doGrab = false;
         bool doGrabSuccess = false;
         std::mutex lockMutex;
         std::condition_variable condition;
+        std::condition_variable batchCondition;
 
     public:
-        GigEVideoCapture(const std::string_view pipeline, const int32_t imageBaseType, const int32_t imageChannels);
+        GigEVideoCapture(const std::string_view pipeline, const std::string& primarySink = "");
+        GigEVideoCapture(const ReplaySource::Options& replay);
+
+        void setGrabMode(const GrabMode mode);
+        GrabMode getGrabMode() const;
+
+        void setOutputConversion(const BayerConverter::Output output);
+        BayerConverter::Output getOutputConversion() const;
+
+        void setCaptureMode(const CaptureMode mode, const size_t ringSize = 8);
+        CaptureMode getCaptureMode() const;
+
+        void setFrameStatistics(const bool enabled);
+        bool getFrameStatistics() const;
+
+        bool restrictFormat(const std::string& caps, const FormatCheck check, const FrameStatistics::Kernel statistics, const CopyKernel copy, const BayerConverter::Kernel conversion, std::string& error);
 
+        bool setIngestion(const IngestOptions& options);
+        IngestOptions getIngestion() const;
+        IngestStatistics getIngestStatistics() const;
+
+        void setThreadScheduling(const ThreadRole role, const ThreadScheduling& scheduling);
+        std::vector<std::string> getThreadSchedulingErrors() const;
+
+        void setWorkerPoolSize(const size_t workerCount);
+        uint64_t subscribe(FrameDispatcher::FrameCallback callback, const FrameDispatcher::Options& options = FrameDispatcher::Options(), const std::string& view = "");
+        bool unsubscribe(const uint64_t id);
+        void setFrameCallback(FrameDispatcher::FrameCallback callback, const FrameDispatcher::Options& options = FrameDispatcher::Options());
+        bool getSubscriptionStatistics(const uint64_t id, FrameDispatcher::Statistics& statistics);
+
+        bool startRecording(const std::string& path, const FrameRecorder::Options& options = FrameRecorder::Options());
+        bool stopRecording();
+        bool getRecordingStatistics(FrameRecorder::Statistics& statistics) const;
+        bool seekReplay(const uint64_t cameraTimestamp);
+        bool startPublishing(const std::string& name, const SharedFramePublisher::Options& options = SharedFramePublisher::Options());
+        bool stopPublishing();
+        bool getPublishingStatistics(SharedFramePublisher::Statistics& statistics) const;
+
+        bool prepare();
         bool start();
         bool grab(cv::Mat& frame);
+        bool grab(cv::Mat& frame, const GrabPolicy policy);
+        bool tryGrab(cv::Mat& frame, const std::chrono::milliseconds timeout, const GrabPolicy policy = GrabPolicy::LATEST);
+        bool grabBatch(FrameBatch& batch, const size_t count, const std::chrono::milliseconds timeout);
+        bool grabView(const std::string& name, cv::Mat& view, const GrabPolicy policy = GrabPolicy::LATEST);
+        bool tryGrabView(const std::string& name, cv::Mat& view, const std::chrono::milliseconds timeout, const GrabPolicy policy = GrabPolicy::LATEST);
+        bool getView(const std::string& name, cv::Mat& view) const;
+        const FrameMetaData& getFrameMetaData() const;
+        FrameFormat getFrameFormat();
         uint64_t getCameraTimestamp() const;
+        uint64_t getHostTimestamp() const;
         double getCameraFrameRate() const;
+        void setClockCorrelation(const ClockCorrelator::Options& options);
+        ClockCorrelator::Estimate getClockEstimate() const;
+
+        void setChangeDetection(const ChangeDetector::Options& options);
+        ChangeDetector::Options getChangeDetection() const;
+        uint64_t getDroppedFrameCount() const;
+        CaptureTelemetry::Snapshot getTelemetry() const;
+        void resetTelemetry();
+        void startTelemetryDump(const std::chrono::milliseconds interval, std::ostream& stream = std::cout);
+        void stopTelemetryDump();
         bool stop();
+        bool reconfigure(const std::string& caps, const std::string& component = "");
 
         bool setBooleanProperty(const std::string& component, const std::string& name, const bool value);
         bool setIntegerProperty(const std::string& component, const std::string& name, const int32_t value);
         bool setDoubleProperty(const std::string& component, const std::string& name, const double value);
         bool setStringProperty(const std::string& component, const std::string& name, const std::string& value);
+        std::future<PropertyTransaction::Result> commitProperties(const PropertyTransaction& transaction);
+        uint64_t getSettingsGeneration() const;
 
         std::vector<std::string> getPipelineComponentNames() const;
+        FrameChannel& getChannel(const std::string& name);
+        std::vector<std::string> getChannelNames() const;
+
+        bool addRegionView(const std::string& name, const cv::Rect& region);
+        bool addPyramidView(const std::string& name, const int32_t level);
+        void clearViews();
+        std::vector<std::string> getViewNames() const;
 
         ~GigEVideoCapture();
 
     private:
-        bool waitForStateChange(GstElement* gstPipeline);
+        bool changeState(const GstState state);
+        bool waitForStateChange(GstBus* bus, const GstState state);
+        bool waitForGrab(std::unique_lock<std::mutex>& lock, const std::chrono::milliseconds* timeout);
+        bool waitForFrame(cv::Mat& frame, const GrabPolicy policy, const std::chrono::milliseconds* timeout, const int32_t view = -1);
+        bool readFrame(cv::Mat& frame, const GrabPolicy policy, const int32_t view);
+        void convertGrabbed(const FrameFormat::BayerPattern pattern, const cv::Mat& raw, const int32_t view, cv::Mat& frame);
+        void convertDispatched(const FrameFormat::BayerPattern pattern, cv::Mat& frame, std::vector<cv::Mat>& views) const;
+        static bool isExclusive(const cv::Mat& frame);
+        static void copyFrame(const cv::Mat& source, cv::Mat& destination);
+        std::vector<cv::Mat>& acquireViewSet();
+        const std::shared_ptr<FrameStatistics>& acquireStatistics();
+        void notifyGrab(const bool success);
+        bool isFrameRequired() const;
+        bool setProperty(const std::string& component, const std::string& name, const PropertyTransaction::Value& value);
+        void stopStreaming();
+        void resetIngestQueue();
+        void applyTransactions();
+        void applyTransaction(PendingTransaction& transaction);
+        void deliver(const cv::Mat& source, const FrameMetaData& capturedMetaData, const std::shared_ptr<void>& owner);
+        void replayFrame(const cv::Mat& source, const FrameMetaData& replayedMetaData, const std::shared_ptr<void>& owner);
+        void replayFinished();
+        bool updateFrameFormat(GstCaps* caps, const size_t bufferSize);
+        GstFlowReturn ingest(GstSample* sample);
+        void puller();
+        void stopPuller();
         static GstFlowReturn handler(GstElement* sink, gpointer userData);
+        void applyThreadScheduling(const ThreadRole role, const pthread_t thread, const std::string& name);
+        static GstBusSyncReply busHandler(GstBus* bus, GstMessage* message, gpointer userData);
+        static GstPadProbeReturn probe(GstPad* pad, GstPadProbeInfo* info, gpointer userData);
 };
 
 #endif
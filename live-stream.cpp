@@ -2,12 +2,24 @@
 // (c) Bit Parallel Ltd (Max van Daalen), March 2022
 //
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
 #include <cstdint>
+#include <deque>
+#include <iomanip>
 #include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
 #include <vector>
 
 #include <opencv2/opencv.hpp>
 
+#include "capture-telemetry.hpp"
 #include "gige-video-capture.hpp"
 
 //
@@ -18,7 +30,279 @@
 //   see, https://www.flir.co.uk/support-center/iis/machine-vision/knowledge-base/lost-ethernet-data-packets-on-linux-systems/
 //
 
-inline static const bool USE_CAMERA_TRIGGER = false;
+//
+// a pipelined live stream, i.e. the grab, convert and display (or headless sink) stages each run on their own thread, connected by bounded queues
+// notes 1, a full queue drops its oldest frame, i.e. a slow display never stalls the capture, the drops are counted per queue
+//       2, the sustained fps, the drop counts and the stage latencies are reported every interval, rather than a line per frame
+//       3, --headless has no display (i.e. for a node without a desktop), it runs until interrupted (ctrl-c) or for --duration seconds
+//       4, the default pipeline is the tcamsrc bayer pipeline for the given serial number, any pipeline can be given (i.e. videotestsrc, for testing without a camera)
+//       5, the tcam properties (auto exposure, white balance and the trigger) are only set if the pipeline has the corresponding components
+//
+// usage: live-stream [--pipeline description] [--serial number] [--trigger off|on] [--convert bgr|gray|none] [--headless]
+//                    [--queue-size frames] [--interval seconds] [--duration seconds]
+//
+//   i.e. live-stream --headless --pipeline "videotestsrc is-live=true pattern=ball ! video/x-raw,format=GRAY8,width=1280,height=960,framerate=30/1 ! appsink"
+//
+
+struct StreamConfig
+{
+    std::string pipeline;
+    std::string serial = "30610380";
+    bool trigger = false;
+    BayerConverter::Output conversion = BayerConverter::Output::BGR;
+    bool headless = false;
+    size_t queueSize = 2;
+    double interval = 1.0;
+    double duration = 0.0;
+};
+
+// a frame passing through the stages, the times are CLOCK_MONOTONIC in nanoseconds, see CaptureTelemetry::now()
+//
+struct StageFrame
+{
+    cv::Mat frame;
+    FrameMetaData metaData;
+    uint64_t grabbed = 0;
+};
+
+// a bounded queue between two stages, when full the oldest frame is dropped, i.e. the later stages always have the most recent frames
+//
+template <typename T>
+class StageQueue
+{
+    private:
+        std::deque<T> items;
+        const size_t capacity;
+        bool closed = false;
+        std::mutex lockMutex;
+        std::condition_variable available;
+
+    public:
+        std::atomic<uint64_t> dropped = 0;
+
+        StageQueue(const size_t queueCapacity):
+            capacity(std::max<size_t>(queueCapacity, 1))
+        {
+        }
+
+        void push(T&& item)
+        {
+            {
+                std::scoped_lock<std::mutex> lock(lockMutex);
+                if (items.size() >= capacity)
+                {
+                    items.pop_front();
+                    dropped++;
+                }
+
+                items.emplace_back(std::move(item));
+            }
+
+            available.notify_one();
+        }
+
+        // returns false on the timeout, or once the queue has been closed and emptied
+        //
+        bool pop(T& item, const std::chrono::milliseconds timeout)
+        {
+            std::unique_lock<std::mutex> lock(lockMutex);
+            available.wait_for(lock, timeout, [this] { return !items.empty() || closed; });
+            if (items.empty()) return false;
+
+            item = std::move(items.front());
+            items.pop_front();
+
+            return true;
+        }
+
+        void close()
+        {
+            {
+                std::scoped_lock<std::mutex> lock(lockMutex);
+                closed = true;
+            }
+
+            available.notify_all();
+        }
+};
+
+// the stage latencies
+// notes 1, grab is from the frame arriving (i.e. in the handler()) to it being grabbed, convert and sink are the time spent in those stages
+//       2, end to end is from the frame arriving to the sink stage finishing with it, i.e. including the time spent in the queues
+//
+struct StageLatencies
+{
+    LatencyHistogram grab;
+    LatencyHistogram convert;
+    LatencyHistogram sink;
+    LatencyHistogram endToEnd;
+};
+
+static std::atomic<bool> stopping = false;
+
+static void interrupted(int32_t)
+{
+    stopping.store(true);
+}
+
+static StreamConfig parseArguments(const int32_t argc, char* argv[])
+{
+    auto config = StreamConfig();
+    for (int32_t i = 1; i < argc; i++)
+    {
+        const auto argument = std::string(argv[i]);
+        const auto value = [&]() {
+            if ((i + 1) >= argc) throw std::string("Missing value for argument: ") + argument;
+            return std::string(argv[++i]);
+        };
+
+        if (argument == "--pipeline") config.pipeline = value();
+        else if (argument == "--serial") config.serial = value();
+        else if (argument == "--headless") config.headless = true;
+        else if (argument == "--queue-size") config.queueSize = std::stoul(value());
+        else if (argument == "--interval") config.interval = std::stod(value());
+        else if (argument == "--duration") config.duration = std::stod(value());
+        else if (argument == "--trigger")
+        {
+            const auto mode = value();
+            if ((mode != "on") && (mode != "off")) throw std::string("Unknown trigger mode: ") + mode;
+            config.trigger = (mode == "on");
+        }
+        else if (argument == "--convert")
+        {
+            const auto output = value();
+            if (output == "bgr") config.conversion = BayerConverter::Output::BGR;
+            else if (output == "gray") config.conversion = BayerConverter::Output::GRAY;
+            else if (output == "none") config.conversion = BayerConverter::Output::NONE;
+            else throw std::string("Unknown conversion: ") + output;
+        }
+        else throw std::string("Unknown argument: ") + argument;
+    }
+
+    // notes 1, the following formats are supported by the DFM-25G445-ML camera, the frame type is derived from the negotiated caps
+    //          (a) video/x-bayer, gbrg (CV_8U, 1), 30/1, 20/1, 15/1, 15/2, 15/4
+    //          (b) video/x-raw, GRAY8 (CV_8U, 1), 30/1, 20/1, 15/1, 15/2, 15/4
+    //       2, do not use "tcambin" as this includes a bayer conversion and will filter out the frame meta data (i.e. the camera timestamp and framerate)
+    //       3, when using trigger mode, set the maximum frame rate otherwise grab() will alias with the camera and potentially miss frames
+    //
+    if (config.pipeline.empty())
+    {
+        config.pipeline = "tcamsrc serial=" + config.serial + " ! video/x-bayer,format=gbrg,width=1280,height=960,framerate=15/1 ! tcamautoexposure ! tcamwhitebalance ! appsink";
+    }
+
+    if (config.interval <= 0.0) throw std::string("The interval must be greater than 0");
+    return config;
+}
+
+static void grabStage(GigEVideoCapture& capture, StageQueue<StageFrame>& output, StageLatencies& latencies)
+{
+    // note, each frame is grabbed into a new buffer, i.e. the queued frames are independent of the capture's (reused) buffers
+    //
+    while (!stopping.load())
+    {
+        auto item = StageFrame();
+        if (!capture.tryGrab(item.frame, std::chrono::milliseconds(100), GigEVideoCapture::GrabPolicy::QUEUED)) continue;
+
+        item.grabbed = CaptureTelemetry::now();
+        item.metaData = capture.getFrameMetaData();
+        latencies.grab.record(item.grabbed - item.metaData.arrivalTime);
+        output.push(std::move(item));
+    }
+
+    output.close();
+}
+
+static void convertStage(GigEVideoCapture& capture, const BayerConverter::Output conversion, StageQueue<StageFrame>& input, StageQueue<StageFrame>& output, StageLatencies& latencies)
+{
+    // the bayer conversion (if any), the frame format is only fetched again if the frame's size or type changes, i.e. after a reconfigure()
+    //
+    auto format = FrameFormat();
+    auto item = StageFrame();
+    while (input.pop(item, std::chrono::milliseconds(100)) || !stopping.load())
+    {
+        if (item.frame.empty()) continue;
+
+        const uint64_t start = CaptureTelemetry::now();
+        if ((item.frame.cols != format.width) || (item.frame.rows != format.height) || (item.frame.type() != format.type)) format = capture.getFrameFormat();
+
+        if ((conversion != BayerConverter::Output::NONE) && format.isBayer())
+        {
+            cv::Mat converted;
+            BayerConverter::convert(item.frame, format.bayerPattern, conversion, converted);
+            item.frame = converted;
+        }
+
+        latencies.convert.record(CaptureTelemetry::now() - start);
+        output.push(std::move(item));
+        item = StageFrame();
+    }
+
+    output.close();
+}
+
+static void report(const double elapsed, const uint64_t frames, const StageQueue<StageFrame>& converting, const StageQueue<StageFrame>& sinking, GigEVideoCapture& capture, StageLatencies& latencies)
+{
+    // note, the latencies are reset after each report, i.e. they are for the interval, the drop counts are totals
+    //
+    const auto milliseconds = [](const uint64_t nanoseconds) { return nanoseconds / 1000000.0; };
+    const auto percentiles = [&milliseconds](LatencyHistogram& histogram) {
+        const auto snapshot = histogram.snapshot();
+        histogram.reset();
+
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(2) << milliseconds(snapshot.p50) << "/" << milliseconds(snapshot.p99) << "/" << milliseconds(snapshot.max);
+        return ss.str();
+    };
+
+    const auto telemetry = capture.getTelemetry();
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "fps: " << (frames / elapsed) << ", dropped: capture " << (telemetry.dropped + telemetry.cameraDropped) << ", convert queue " << converting.dropped;
+    std::cout << ", sink queue " << sinking.dropped << ", latency p50/p99/max (ms): grab " << percentiles(latencies.grab) << ", convert " << percentiles(latencies.convert);
+    std::cout << ", sink " << percentiles(latencies.sink) << ", end to end " << percentiles(latencies.endToEnd) << std::endl;
+}
+
+static bool hasComponent(GigEVideoCapture& capture, const std::string& name)
+{
+    const auto names = capture.getPipelineComponentNames();
+    return std::find(names.begin(), names.end(), name) != names.end();
+}
+
+static void configureCamera(GigEVideoCapture& capture, const StreamConfig& config, const bool started)
+{
+    // set any appropriate pipeline properties, i.e. only if the pipeline has the tcam components
+    // notes 1, some properties can be set before the pipeline has been started, others must be set afterwards
+    //       2, the default state of "whitebalance-module-enabled" is true, white balance only works with colour images
+    //       3, it's best to turn off auto exposure and gain (also auto white balance) when using trigger mode
+    //       4, the trigger needs to be disabled before starting the gstreamer pipeline, then enabled afterwards
+    //
+    if (!started)
+    {
+        if (config.trigger && hasComponent(capture, "tcamsrc0"))
+        {
+            capture.setStringProperty("tcamsrc0", "Trigger Source", "Line1");
+            capture.setStringProperty("tcamsrc0", "Trigger Activation", "RisingEdge");
+            capture.setStringProperty("tcamsrc0", "Trigger Mode", "Off");
+        }
+
+        if (hasComponent(capture, "tcamwhitebalance0")) capture.setBooleanProperty("tcamwhitebalance0", "whitebalance-module-enabled", true);
+        return;
+    }
+
+    if (hasComponent(capture, "tcamautoexposure0"))
+    {
+        capture.setBooleanProperty("tcamautoexposure0", "Exposure Auto", true);
+        capture.setIntegerProperty("tcamautoexposure0", "Brightness Reference", 80);
+        capture.setBooleanProperty("tcamautoexposure0", "Gain Auto", true);
+    }
+
+    if (config.trigger && hasComponent(capture, "tcamsrc0"))
+    {
+        // FIXME! needs testing with automatic values, not sure when they get applied, hopefully not after a trigger...
+        //
+        capture.setStringProperty("tcamsrc0", "Trigger Mode", "On");
+        std::cout << "Trigger Mode: On\n";
+    }
+}
 
 int32_t main(int32_t argc, char* argv[])
 {
@@ -30,100 +314,86 @@ int32_t main(int32_t argc, char* argv[])
 
     try
     {
-        // notes 1, the following formats are supported by the DFM-25G445-ML camera
-        //          (a) video/x-bayer, gbrg (CV_8U, 1), 30/1, 20/1, 15/1, 15/2, 15/4
-        //          (b) video/x-raw, GRAY8 (CV_8U, 1), 30/1, 20/1, 15/1, 15/2, 15/4
-        //       2, do not use "tcambin" as this includes a bayer conversion and will filter out the frame meta data (i.e. the camera timestamp and framerate)
-        //       3, when using trigger mode, set the maximum frame rate otherwise grab() will alias with the camera and potentially miss frames
+        const auto config = parseArguments(argc, argv);
+        auto capture = GigEVideoCapture(config.pipeline);
+
+        // note, the capture queues its frames so that a slow stage is seen as a queue drop rather than as the capture missing frames
         //
-//      const auto pipeline = "tcamsrc serial=30610380 ! video/x-raw,format=GRAY8,width=1280,height=960,framerate=30/1 ! appsink";
-//      const auto pipeline = "tcamsrc serial=30610380 ! video/x-raw,format=GRAY8,width=1280,height=960,framerate=15/1 ! tcamautoexposure ! appsink";
-        const auto pipeline = "tcamsrc serial=30610380 ! video/x-bayer,format=gbrg,width=1280,height=960,framerate=15/1 ! tcamautoexposure ! tcamwhitebalance ! appsink";
-        auto capture = GigEVideoCapture(pipeline, CV_8U, 1);
+        capture.setCaptureMode(GigEVideoCapture::CaptureMode::CONTINUOUS);
 
         // displaying for reference only, useful when setting pipeline properties
         //
         std::cout << "Pipeline Component Names:\n";
         for (std::string_view name : capture.getPipelineComponentNames()) std::cout << "  " << name << "\n";
 
-        if (USE_CAMERA_TRIGGER)
-        {
-            // the trigger needs to be disabled before starting the gstreamer pipeline
-            //
-            capture.setStringProperty("tcamsrc0", "Trigger Source", "Line1");
-            capture.setStringProperty("tcamsrc0", "Trigger Activation", "RisingEdge");
-            capture.setStringProperty("tcamsrc0", "Trigger Mode", "Off");
-        }
+        configureCamera(capture, config, false);
+        if (!capture.start()) return 1;
 
-        // set any appropriate pre-start pipeline properties
-        // notes 1, some properties can be set before the pipeline has been started, others must be set afterwards
-        //       2, the default state of "whitebalance-module-enabled" is true
-        //       3, white balance only works with colour images
-        //       4, it's best to turn off auto white balance when using trigger mode
-        //
-        capture.setBooleanProperty("tcamwhitebalance0", "whitebalance-module-enabled", true);
+        configureCamera(capture, config, true);
+        std::signal(SIGINT, interrupted);
+        std::signal(SIGTERM, interrupted);
+
+        StageLatencies latencies;
+        StageQueue<StageFrame> converting(config.queueSize);
+        StageQueue<StageFrame> sinking(config.queueSize);
+        auto grabThread = std::thread(grabStage, std::ref(capture), std::ref(converting), std::ref(latencies));
+        auto convertThread = std::thread(convertStage, std::ref(capture), config.conversion, std::ref(converting), std::ref(sinking), std::ref(latencies));
 
-        // starts the gstreamer pipline
+        // the sink stage, i.e. the display (highgui must run on the main thread) or the headless sink
         //
-        if (capture.start())
+        if (!config.headless) cv::namedWindow("Live Frame", 1);
+
+        const auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(config.interval));
+        const auto start = std::chrono::steady_clock::now();
+        auto nextReport = start + interval;
+        auto intervalStart = start;
+        uint64_t intervalFrames = 0;
+
+        auto item = StageFrame();
+        while (!stopping.load())
         {
-            // note, it's best to turn off auto exposure and gain (also auto white ballance) when using trigger mode
-            // set any appropriate post-start pipeline properties
-            //       1, the default state of "Exposure Auto" is  true
-            //       2, the default state of "Gain Auto" is  true
-            //
-            capture.setBooleanProperty("tcamautoexposure0", "Exposure Auto", true);
-            capture.setIntegerProperty("tcamautoexposure0", "Brightness Reference", 80);
-            capture.setBooleanProperty("tcamautoexposure0", "Gain Auto", true);
-//          capture.setIntegerProperty("tcamsrc0", "Exposure", 800);
-//          capture.setDoubleProperty("tcamsrc0", "Gain", 2.97);
-
-            auto frame = cv::Mat(960, 1280, CV_8UC1, cv::Scalar(0, 0, 0));
-            cv::namedWindow("Live Frame", 1);
-            if (USE_CAMERA_TRIGGER)
+            const auto now = std::chrono::steady_clock::now();
+            if ((config.duration > 0.0) && (std::chrono::duration<double>(now - start).count() >= config.duration)) break;
+
+            if (now >= nextReport)
             {
-                // enable the trigger after setting manual exposure and gain values
-                // FIXME! needs testing with automatic values, not sure when they get applied, hopefully not after a trigger...
-                //
-                capture.setStringProperty("tcamsrc0", "Trigger Mode", "On");
-                std::cout << "Trigger Mode: On\n";
-
-                // note, it takes quiter a bit of time to open and display the first highgui window
-                //       this is only apparent when in trigger mode
-                //
-                cv::imshow("Live Frame", frame);
-                cv::waitKey(350);
+                report(std::chrono::duration<double>(now - intervalStart).count(), intervalFrames, converting, sinking, capture, latencies);
+                intervalStart = now;
+                intervalFrames = 0;
+                nextReport += interval;
             }
 
-            uint64_t previousTimestamp = 0;
-            while (true)
+            if (sinking.pop(item, std::chrono::milliseconds(config.headless ? 100 : 1)))
             {
-                auto success = capture.grab(frame);
-                if (!success) std::cout << "The frame grab() failed, using the last valid frame\n";
+                const uint64_t sinkStart = CaptureTelemetry::now();
+                if (!config.headless) cv::imshow("Live Frame", item.frame);
 
-                cv::cvtColor(frame, frame, cv::COLOR_BayerGBRG2BGR);
-//              cv::cvtColor(frame, frame, cv::COLOR_BayerGBRG2GRAY);
-                cv::imshow("Live Frame", frame);
+                const uint64_t sinkEnd = CaptureTelemetry::now();
+                latencies.sink.record(sinkEnd - sinkStart);
+                latencies.endToEnd.record(sinkEnd - item.metaData.arrivalTime);
+                intervalFrames++;
+            }
 
-                const uint64_t timestamp = capture.getCameraTimestamp();
-                std::cout << "Timestamp: " << ((timestamp - previousTimestamp) / 1000000.0) << "\n";
-                previousTimestamp = timestamp;
+            if (!config.headless && ((cv::waitKey(1) & 0xff) == 27)) break;
+        }
 
-                const int32_t ch = cv::waitKey(1) & 0xff;
-                if (ch == 27) break;
-            }
+        stopping.store(true);
+        grabThread.join();
+        convertThread.join();
 
-            if (USE_CAMERA_TRIGGER) capture.setStringProperty("tcamsrc0", "Trigger Mode", "Off");
+        if (config.trigger && hasComponent(capture, "tcamsrc0")) capture.setStringProperty("tcamsrc0", "Trigger Mode", "Off");
 
-            // stop the pipeline and free up its memory
-            //
-            capture.stop();
-            cv::destroyAllWindows();
-        }
+        // stop the pipeline and free up its memory
+        //
+        capture.stop();
+        if (!config.headless) cv::destroyAllWindows();
+
+        std::cout << capture.getTelemetry().toString();
     }
     catch (const std::string& exception)
     {
         std::cout << "Exception: " << exception << "\n";
+        return 1;
     }
 
     return 0;
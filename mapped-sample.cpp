@@ -0,0 +1,63 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#include <gstmetatcamstatistics.h>
+#include <gst/video/video.h>
+
+#include "mapped-sample.hpp"
+
+MappedSample::MappedSample(GstSample* mappedSample, GstBuffer* mappedBuffer, const GstMapInfo& mappedInfo):
+    sample(mappedSample), buffer(mappedBuffer), info(mappedInfo)
+{
+}
+
+MappedSample::~MappedSample()
+{
+    gst_buffer_unmap(buffer, &info);
+    gst_sample_unref(sample);
+}
+
+bool MappedSample::view(const FrameFormat& format, cv::Mat& frame) const
+{
+    // notes 1, the buffer's video meta (if present) takes precedence over the stride and offset derived from the caps
+    //       2, the frame is described by a cv::Mat header for the mapped buffer, i.e. nothing is copied here
+    //       3, returns false if the mapped buffer is too small for the format
+    //
+    size_t stride = format.stride, offset = format.offset;
+    GstVideoMeta* videoMeta = gst_buffer_get_video_meta(buffer);
+    if (videoMeta)
+    {
+        stride = videoMeta->stride[0];
+        offset = videoMeta->offset[0];
+    }
+
+    if (info.size < (offset + (stride * (format.height - 1)) + format.rowBytes)) return false;
+
+    frame = cv::Mat(format.height, format.width, format.type, info.data + offset, stride);
+    return true;
+}
+
+bool MappedSample::readMetaData(FrameMetaData& metaData) const
+{
+    // returns true if the camera's frame counters are available, i.e. from the TcamStatisticsMeta
+    //
+    GstMeta* gstMeta = gst_buffer_get_meta(buffer, g_type_from_name("TcamStatisticsMetaApi"));
+    if (gstMeta)
+    {
+        GstStructure* gstMetaData = ((TcamStatisticsMeta*)gstMeta)->structure;
+        gst_structure_get_uint64(gstMetaData, "camera_time_ns", &(metaData.cameraTimestamp));
+        gst_structure_get_double(gstMetaData, "framerate", &(metaData.cameraFrameRate));
+
+        return gst_structure_get_uint64(gstMetaData, "frame_count", &(metaData.cameraFrameCount)) && gst_structure_get_uint64(gstMetaData, "frames_dropped", &(metaData.cameraFramesDropped));
+    }
+
+    if (GST_CLOCK_TIME_IS_VALID(GST_BUFFER_PTS(buffer)))
+    {
+        // not a tcam source (i.e. videotestsrc), so fall back to the buffer's presentation timestamp
+        //
+        metaData.cameraTimestamp = GST_BUFFER_PTS(buffer);
+    }
+
+    return false;
+}
@@ -0,0 +1,30 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#ifndef H_MAPPED_SAMPLE
+#define H_MAPPED_SAMPLE
+
+#include <gst/gst.h>
+#include <opencv2/opencv.hpp>
+
+#include "frame-format.hpp"
+#include "frame-meta-data.hpp"
+
+// owns a pulled sample and the mapping of its buffer, used as the ZeroCopyAllocator owner when in GrabMode::ZERO_COPY
+// i.e. the buffer is unmapped and the sample released when the last cv::Mat referencing it is released
+//
+struct MappedSample
+{
+    GstSample* sample;
+    GstBuffer* buffer;
+    GstMapInfo info;
+
+    MappedSample(GstSample* mappedSample, GstBuffer* mappedBuffer, const GstMapInfo& mappedInfo);
+    ~MappedSample();
+
+    bool view(const FrameFormat& format, cv::Mat& frame) const;
+    bool readMetaData(FrameMetaData& metaData) const;
+};
+
+#endif
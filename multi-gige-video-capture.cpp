@@ -0,0 +1,145 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#include <algorithm>
+
+#include "multi-gige-video-capture.hpp"
+
+MultiGigEVideoCapture::MultiGigEVideoCapture(const std::vector<std::string>& pipelines, const std::chrono::nanoseconds matchTolerance, const size_t ringSize):
+    pendingFrames(pipelines.size()), pendingMetaData(pipelines.size()), pending(pipelines.size(), false), tolerance(matchTolerance.count())
+{
+    if (pipelines.empty()) throw std::string("At least one pipeline is required");
+
+    // note, the frames are consumed in FIFO order so that no frame is skipped while searching for a match
+    //
+    for (const auto& pipeline : pipelines)
+    {
+        auto capture = std::make_unique<GigEVideoCapture>(pipeline);
+        capture->setCaptureMode(GigEVideoCapture::CaptureMode::CONTINUOUS, ringSize);
+        captures.emplace_back(std::move(capture));
+    }
+}
+
+size_t MultiGigEVideoCapture::size() const
+{
+    return captures.size();
+}
+
+GigEVideoCapture& MultiGigEVideoCapture::getCapture(const size_t index)
+{
+    // note, used to set the pipeline properties of each of the cameras
+    //
+    return *captures.at(index);
+}
+
+void MultiGigEVideoCapture::setGrabMode(const GigEVideoCapture::GrabMode mode)
+{
+    for (auto& capture : captures) capture->setGrabMode(mode);
+}
+
+bool MultiGigEVideoCapture::prepare()
+{
+    // note, puts every camera into warm standby, so that the following start() brings them up together as quickly as possible
+    //
+    bool success = true;
+    for (auto& capture : captures) success = capture->prepare() && success;
+
+    return success;
+}
+
+bool MultiGigEVideoCapture::start()
+{
+    bool success = true;
+    for (auto& capture : captures) success = capture->start() && success;
+
+    return success;
+}
+
+bool MultiGigEVideoCapture::grabSet(std::vector<cv::Mat>& frames, std::vector<FrameMetaData>& metaData)
+{
+    return waitForSet(frames, metaData, nullptr);
+}
+
+bool MultiGigEVideoCapture::tryGrabSet(std::vector<cv::Mat>& frames, std::vector<FrameMetaData>& metaData, const std::chrono::milliseconds timeout)
+{
+    return waitForSet(frames, metaData, &timeout);
+}
+
+bool MultiGigEVideoCapture::waitForSet(std::vector<cv::Mat>& frames, std::vector<FrameMetaData>& metaData, const std::chrono::milliseconds* timeout)
+{
+    const auto deadline = std::chrono::steady_clock::now() + (timeout ? *timeout : std::chrono::milliseconds(0));
+    while (true)
+    {
+        // notes 1, make sure that there is a pending frame from every camera
+        //       2, any pending frames are kept if this times out, they will be used by the next call
+        //
+        for (size_t i = 0; i < captures.size(); i++)
+        {
+            if (pending[i]) continue;
+
+            if (timeout == nullptr)
+            {
+                if (!captures[i]->grab(pendingFrames[i], GigEVideoCapture::GrabPolicy::QUEUED)) return false;
+            }
+            else
+            {
+                const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+                if (!captures[i]->tryGrab(pendingFrames[i], std::max(remaining, std::chrono::milliseconds(0)), GigEVideoCapture::GrabPolicy::QUEUED)) return false;
+            }
+
+            pendingMetaData[i] = captures[i]->getFrameMetaData();
+            pending[i] = true;
+        }
+
+        // any pending frame that is older than the newest pending frame (by more than the tolerance) can never be part of a complete set
+        // so discard it and grab the next frame from that camera
+        //
+        uint64_t newest = 0;
+        for (const auto& frameMetaData : pendingMetaData) newest = std::max(newest, frameMetaData.cameraTimestamp);
+
+        bool matched = true;
+        for (size_t i = 0; i < captures.size(); i++)
+        {
+            if ((newest - pendingMetaData[i].cameraTimestamp) > tolerance)
+            {
+                pending[i] = false;
+                statistics.discardedFrames++;
+                matched = false;
+            }
+        }
+
+        if (matched) break;
+        statistics.incompleteSets++;
+    }
+
+    // note, swapping hands the matched frames to the caller and reuses the caller's previous frame buffers
+    //
+    frames.resize(captures.size());
+    metaData.resize(captures.size());
+    for (size_t i = 0; i < captures.size(); i++)
+    {
+        std::swap(frames[i], pendingFrames[i]);
+        metaData[i] = pendingMetaData[i];
+        pending[i] = false;
+    }
+
+    statistics.completeSets++;
+    return true;
+}
+
+MultiGigEVideoCapture::Statistics MultiGigEVideoCapture::getStatistics() const
+{
+    auto current = statistics;
+    for (const auto& capture : captures) current.droppedFrames += capture->getDroppedFrameCount();
+
+    return current;
+}
+
+bool MultiGigEVideoCapture::stop()
+{
+    bool success = true;
+    for (auto& capture : captures) success = capture->stop() && success;
+
+    return success;
+}
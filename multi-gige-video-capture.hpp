@@ -0,0 +1,61 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#ifndef H_MULTI_GIGE_VIDEO_CAPTURE
+#define H_MULTI_GIGE_VIDEO_CAPTURE
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "frame-meta-data.hpp"
+#include "gige-video-capture.hpp"
+
+// captures from several cameras and emits frame sets that have been matched on their camera timestamps
+// notes 1, each camera has its own pipeline and streaming thread, capturing into its own lock free ring (i.e. CaptureMode::CONTINUOUS)
+//       2, the frame sets are matched by the consumer thread calling grabSet(), so there is no lock shared between the cameras
+//       3, the camera clocks must be synchronised for the timestamps to be comparable, i.e. enable PTP on each of the cameras
+//
+class MultiGigEVideoCapture
+{
+    public:
+        struct Statistics
+        {
+            uint64_t completeSets = 0;
+            uint64_t incompleteSets = 0;
+            uint64_t discardedFrames = 0;
+            uint64_t droppedFrames = 0;
+        };
+
+    private:
+        std::vector<std::unique_ptr<GigEVideoCapture>> captures;
+        std::vector<cv::Mat> pendingFrames;
+        std::vector<FrameMetaData> pendingMetaData;
+        std::vector<bool> pending;
+        uint64_t tolerance;
+        Statistics statistics;
+
+    public:
+        MultiGigEVideoCapture(const std::vector<std::string>& pipelines, const std::chrono::nanoseconds matchTolerance, const size_t ringSize = 8);
+
+        size_t size() const;
+        GigEVideoCapture& getCapture(const size_t index);
+        void setGrabMode(const GigEVideoCapture::GrabMode mode);
+
+        bool prepare();
+        bool start();
+        bool grabSet(std::vector<cv::Mat>& frames, std::vector<FrameMetaData>& metaData);
+        bool tryGrabSet(std::vector<cv::Mat>& frames, std::vector<FrameMetaData>& metaData, const std::chrono::milliseconds timeout);
+        Statistics getStatistics() const;
+        bool stop();
+
+    private:
+        bool waitForSet(std::vector<cv::Mat>& frames, std::vector<FrameMetaData>& metaData, const std::chrono::milliseconds* timeout);
+};
+
+#endif
@@ -0,0 +1,134 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#ifndef H_PIXEL_FORMAT
+#define H_PIXEL_FORMAT
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include <opencv2/opencv.hpp>
+
+#include "frame-format.hpp"
+#include "frame-statistics.hpp"
+
+// the compile time pixel format traits, i.e. the template parameters of TypedGigEVideoCapture
+// notes 1, each format gives its cv::Mat depth, channels and type, its bayer pattern (if any), its element and pixel types and the caps it is negotiated with
+//       2, the 16 bit bayer formats accept any of the unpacked 10, 12, 14 and 16 bit caps, i.e. as for FrameFormat they are held in a 16 bit container
+//       3, statisticsKernel() is the frame statistics kernel specialised for the format, see FrameStatistics::compute<Depth, Pattern>()
+//       4, copy() is the frame copy specialised for the format, i.e. the type and row size are constants rather than read from the cv::Mat for each frame
+//          the source must be of the format, as it is once restrictFormat() has fixed the caps, see GigEVideoCapture::CopyKernel
+//
+template <int32_t Depth, int32_t Channels, FrameFormat::BayerPattern Pattern = FrameFormat::BayerPattern::NONE>
+struct PixelFormat
+{
+    static_assert((Depth == CV_8U) || (Depth == CV_16U), "Only 8 and 16 bit pixel formats are supported");
+    static_assert((Channels == 1) || (Channels == 3) || (Channels == 4), "Only 1, 3 and 4 channel pixel formats are supported");
+    static_assert((Pattern == FrameFormat::BayerPattern::NONE) || (Channels == 1), "The bayer pixel formats must be single channel");
+
+    static constexpr int32_t depth = Depth;
+    static constexpr int32_t channels = Channels;
+    static constexpr int32_t type = CV_MAKETYPE(Depth, Channels);
+    static constexpr FrameFormat::BayerPattern bayerPattern = Pattern;
+    static constexpr bool isBayer = (Pattern != FrameFormat::BayerPattern::NONE);
+
+    using Element = std::conditional_t<Depth == CV_8U, uint8_t, uint16_t>;
+    using Pixel = std::conditional_t<Channels == 1, Element, cv::Vec<Element, Channels>>;
+
+    static bool matches(const FrameFormat& format)
+    {
+        return (format.type == type) && (format.bayerPattern == bayerPattern);
+    }
+
+    static FrameStatistics::Kernel statisticsKernel()
+    {
+        if constexpr (Channels == 1) return &FrameStatistics::compute<Depth, Pattern>;
+        else return nullptr;
+    }
+
+    static void copy(const cv::Mat& source, cv::Mat& destination)
+    {
+        // note, as for cv::Mat::copyTo(), the destination is only (re)allocated if its size or type has changed
+        //
+        destination.create(source.rows, source.cols, type);
+
+        const size_t rowBytes = static_cast<size_t>(source.cols) * sizeof(Pixel);
+        if (source.isContinuous() && destination.isContinuous())
+        {
+            std::memcpy(destination.data, source.data, rowBytes * source.rows);
+            return;
+        }
+
+        for (int32_t row = 0; row < source.rows; row++) std::memcpy(destination.ptr(row), source.ptr(row), rowBytes);
+    }
+};
+
+struct Gray8: PixelFormat<CV_8U, 1>
+{
+    static constexpr const char* caps = "video/x-raw,format=GRAY8";
+};
+
+struct Gray16: PixelFormat<CV_16U, 1>
+{
+    static constexpr const char* caps = "video/x-raw,format=GRAY16_LE";
+};
+
+struct BGR8: PixelFormat<CV_8U, 3>
+{
+    static constexpr const char* caps = "video/x-raw,format=BGR";
+};
+
+struct BGRx8: PixelFormat<CV_8U, 4>
+{
+    static constexpr const char* caps = "video/x-raw,format=BGRx";
+};
+
+// note, an output format only, i.e. the BGR conversion of a 16 bit bayer format, see TypedGigEVideoCapture
+//
+struct BGR16: PixelFormat<CV_16U, 3>
+{
+};
+
+struct BayerGBRG8: PixelFormat<CV_8U, 1, FrameFormat::BayerPattern::GBRG>
+{
+    static constexpr const char* caps = "video/x-bayer,format=gbrg";
+};
+
+struct BayerRGGB8: PixelFormat<CV_8U, 1, FrameFormat::BayerPattern::RGGB>
+{
+    static constexpr const char* caps = "video/x-bayer,format=rggb";
+};
+
+struct BayerGRBG8: PixelFormat<CV_8U, 1, FrameFormat::BayerPattern::GRBG>
+{
+    static constexpr const char* caps = "video/x-bayer,format=grbg";
+};
+
+struct BayerBGGR8: PixelFormat<CV_8U, 1, FrameFormat::BayerPattern::BGGR>
+{
+    static constexpr const char* caps = "video/x-bayer,format=bggr";
+};
+
+struct BayerGBRG16: PixelFormat<CV_16U, 1, FrameFormat::BayerPattern::GBRG>
+{
+    static constexpr const char* caps = "video/x-bayer,format={gbrg10,gbrg12,gbrg14,gbrg16,gbrg10le,gbrg12le,gbrg14le,gbrg16le}";
+};
+
+struct BayerRGGB16: PixelFormat<CV_16U, 1, FrameFormat::BayerPattern::RGGB>
+{
+    static constexpr const char* caps = "video/x-bayer,format={rggb10,rggb12,rggb14,rggb16,rggb10le,rggb12le,rggb14le,rggb16le}";
+};
+
+struct BayerGRBG16: PixelFormat<CV_16U, 1, FrameFormat::BayerPattern::GRBG>
+{
+    static constexpr const char* caps = "video/x-bayer,format={grbg10,grbg12,grbg14,grbg16,grbg10le,grbg12le,grbg14le,grbg16le}";
+};
+
+struct BayerBGGR16: PixelFormat<CV_16U, 1, FrameFormat::BayerPattern::BGGR>
+{
+    static constexpr const char* caps = "video/x-bayer,format={bggr10,bggr12,bggr14,bggr16,bggr10le,bggr12le,bggr14le,bggr16le}";
+};
+
+#endif
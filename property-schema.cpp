@@ -0,0 +1,148 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#include <tcamprop.h>
+
+#include "property-schema.hpp"
+
+PropertySchema::PropertySchema(const std::unordered_map<std::string, GstElement*>& pipelineElements):
+    elements(pipelineElements)
+{
+}
+
+bool PropertySchema::resolve(const std::string& component, const std::string& name, Property& property, std::string& error)
+{
+    const auto key = component + ":" + name;
+    const auto cached = properties.find(key);
+    if (cached != properties.end())
+    {
+        property = cached->second;
+        return true;
+    }
+
+    const auto element = elements.find(component);
+    if (element == elements.end())
+    {
+        error = "Pipeline component key \"" + component + "\" does not exist";
+        return false;
+    }
+
+    auto resolved = Property();
+    resolved.component = component;
+    resolved.name = name;
+    resolved.element = element->second;
+
+    // note, the tcam property types are reported by name, the enum values are set using their names
+    //
+    if (TCAM_IS_PROP(resolved.element))
+    {
+        gchar* type = tcam_prop_get_tcam_property_type(TCAM_PROP(resolved.element), name.c_str());
+        if (type != nullptr)
+        {
+            const auto typeName = std::string(type);
+            g_free(type);
+
+            if ((typeName == "boolean") || (typeName == "button")) resolved.type = G_TYPE_BOOLEAN;
+            else if (typeName == "integer") resolved.type = G_TYPE_INT;
+            else if (typeName == "double") resolved.type = G_TYPE_DOUBLE;
+            else if ((typeName == "string") || (typeName == "enum")) resolved.type = G_TYPE_STRING;
+        }
+    }
+
+    if (resolved.type == G_TYPE_INVALID)
+    {
+        GParamSpec* paramSpec = g_object_class_find_property(G_OBJECT_GET_CLASS(resolved.element), name.c_str());
+        if (paramSpec != nullptr)
+        {
+            if (!(paramSpec->flags & G_PARAM_WRITABLE))
+            {
+                error = "Property: " + name + ", for component: " + component + " is read only";
+                return false;
+            }
+
+            resolved.paramSpec = paramSpec;
+            resolved.type = G_PARAM_SPEC_VALUE_TYPE(paramSpec);
+        }
+    }
+
+    if (resolved.type == G_TYPE_INVALID)
+    {
+        error = "Property: " + name + ", for component: " + component + " does not exist";
+        return false;
+    }
+
+    properties.emplace(key, resolved);
+    property = resolved;
+
+    return true;
+}
+
+bool PropertySchema::convert(const Property& property, const PropertyTransaction::Value& value, GValue& converted, std::string& error)
+{
+    // note, converted is initialised to the property's type, it must be unset by the caller if successful
+    //
+    GValue source = G_VALUE_INIT;
+    if (std::holds_alternative<bool>(value))
+    {
+        g_value_init(&source, G_TYPE_BOOLEAN);
+        g_value_set_boolean(&source, std::get<bool>(value));
+    }
+    else if (std::holds_alternative<int32_t>(value))
+    {
+        g_value_init(&source, G_TYPE_INT);
+        g_value_set_int(&source, std::get<int32_t>(value));
+    }
+    else if (std::holds_alternative<double>(value))
+    {
+        g_value_init(&source, G_TYPE_DOUBLE);
+        g_value_set_double(&source, std::get<double>(value));
+    }
+    else
+    {
+        g_value_init(&source, G_TYPE_STRING);
+        g_value_set_string(&source, std::get<std::string>(value).c_str());
+    }
+
+    // notes 1, g_value_transform() handles the numeric conversions (i.e. an integer to a double property)
+    //       2, gst_value_deserialize() handles strings for any other type (i.e. an enum property's nick or value)
+    //
+    g_value_init(&converted, property.type);
+    bool success = g_value_type_transformable(G_VALUE_TYPE(&source), property.type) && g_value_transform(&source, &converted);
+    if (!success && (G_VALUE_TYPE(&source) == G_TYPE_STRING)) success = gst_value_deserialize(&converted, g_value_get_string(&source));
+    g_value_unset(&source);
+
+    if (!success)
+    {
+        error = "Unable to convert the value of property: " + property.name + ", for component: " + property.component + " to type: " + g_type_name(property.type);
+    }
+    else if ((property.paramSpec != nullptr) && g_param_value_validate(property.paramSpec, &converted))
+    {
+        // note, the value was modified (i.e. clamped) to make it valid, so it is out of range
+        //
+        error = "The value of property: " + property.name + ", for component: " + property.component + " is out of range";
+        success = false;
+    }
+
+    if (!success) g_value_unset(&converted);
+    return success;
+}
+
+bool PropertySchema::apply(const Property& property, const GValue& value, std::string& error)
+{
+    if (property.paramSpec != nullptr)
+    {
+        // note, already converted and validated, so this can't fail
+        //
+        g_object_set_property(G_OBJECT(property.element), property.name.c_str(), &value);
+        return true;
+    }
+
+    if (!tcam_prop_set_tcam_property(TCAM_PROP(property.element), property.name.c_str(), &value))
+    {
+        error = "Error setting property: " + property.name + ", for component: " + property.component;
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,46 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#ifndef H_PROPERTY_SCHEMA
+#define H_PROPERTY_SCHEMA
+
+#include <string>
+#include <unordered_map>
+
+#include <gst/gst.h>
+
+#include "property-transaction.hpp"
+
+// resolves pipeline properties (i.e. the element and the property's type) once, and caches them for every later change
+// notes 1, tcam properties take precedence (as for the setXProperty() methods), otherwise the element's own GObject property is used
+//          i.e. the stock gstreamer elements (videotestsrc etc.) can also be configured
+//       2, the values are converted to the property's type (and range checked if a GObject property) before they are applied
+//          so that a transaction can be rejected before any of its changes have been applied
+//       3, not thread safe, resolve() is only called by the GigEVideoCapture user thread, apply() only uses the resolved property
+//
+class PropertySchema
+{
+    public:
+        struct Property
+        {
+            std::string component;
+            std::string name;
+            GstElement* element = nullptr;
+            GParamSpec* paramSpec = nullptr;
+            GType type = G_TYPE_INVALID;
+        };
+
+    private:
+        const std::unordered_map<std::string, GstElement*>& elements;
+        std::unordered_map<std::string, Property> properties;
+
+    public:
+        PropertySchema(const std::unordered_map<std::string, GstElement*>& pipelineElements);
+
+        bool resolve(const std::string& component, const std::string& name, Property& property, std::string& error);
+        static bool convert(const Property& property, const PropertyTransaction::Value& value, GValue& converted, std::string& error);
+        static bool apply(const Property& property, const GValue& value, std::string& error);
+};
+
+#endif
@@ -0,0 +1,44 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#include "property-transaction.hpp"
+
+PropertyTransaction& PropertyTransaction::setBoolean(const std::string& component, const std::string& name, const bool value)
+{
+    changes.emplace_back(Change{component, name, Value(value)});
+    return *this;
+}
+
+PropertyTransaction& PropertyTransaction::setInteger(const std::string& component, const std::string& name, const int32_t value)
+{
+    changes.emplace_back(Change{component, name, Value(value)});
+    return *this;
+}
+
+PropertyTransaction& PropertyTransaction::setDouble(const std::string& component, const std::string& name, const double value)
+{
+    changes.emplace_back(Change{component, name, Value(value)});
+    return *this;
+}
+
+PropertyTransaction& PropertyTransaction::setString(const std::string& component, const std::string& name, const std::string& value)
+{
+    changes.emplace_back(Change{component, name, Value(value)});
+    return *this;
+}
+
+const std::vector<PropertyTransaction::Change>& PropertyTransaction::getChanges() const
+{
+    return changes;
+}
+
+bool PropertyTransaction::empty() const
+{
+    return changes.empty();
+}
+
+void PropertyTransaction::clear()
+{
+    changes.clear();
+}
@@ -0,0 +1,56 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#ifndef H_PROPERTY_TRANSACTION
+#define H_PROPERTY_TRANSACTION
+
+#include <cstdint>
+#include <string>
+#include <variant>
+#include <vector>
+
+// a batch of pipeline property changes, applied together between two frames, see GigEVideoCapture::commitProperties()
+// notes 1, the changes are applied in the order that they were added
+//       2, the value types match the setXProperty() methods, the value is converted to the property's own type when committed
+//          i.e. an integer can set a double property, a string can set an enum property
+//
+class PropertyTransaction
+{
+    public:
+        using Value = std::variant<bool, int32_t, double, std::string>;
+
+        struct Change
+        {
+            std::string component;
+            std::string name;
+            Value value;
+        };
+
+        // notes 1, success is only true if every change was applied
+        //       2, generation is the settings generation that the transaction created, frames tagged with it (or later) were captured after it was applied
+        //          it is 0 if the transaction was rejected, i.e. nothing was applied
+        //       3, errors has an entry for each change that could not be resolved, converted or applied
+        //
+        struct Result
+        {
+            bool success = false;
+            uint64_t generation = 0;
+            std::vector<std::string> errors;
+        };
+
+    private:
+        std::vector<Change> changes;
+
+    public:
+        PropertyTransaction& setBoolean(const std::string& component, const std::string& name, const bool value);
+        PropertyTransaction& setInteger(const std::string& component, const std::string& name, const int32_t value);
+        PropertyTransaction& setDouble(const std::string& component, const std::string& name, const double value);
+        PropertyTransaction& setString(const std::string& component, const std::string& name, const std::string& value);
+
+        const std::vector<Change>& getChanges() const;
+        bool empty() const;
+        void clear();
+};
+
+#endif
@@ -0,0 +1,79 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#ifndef H_RECORDING_FORMAT
+#define H_RECORDING_FORMAT
+
+#include <cstddef>
+#include <cstdint>
+
+// the chunked, append only, raw frame recording format
+// notes 1, the file is a header block, followed by fixed size chunks, followed by an index (only if the recording was closed cleanly)
+//       2, every block is a multiple of RECORDING_BLOCK_SIZE, so the file can be written using O_DIRECT
+//       3, each chunk is a chunk header block (a RecordingChunkHeader followed by a RecordingIndexEntry per frame) and then framesPerChunk frames
+//          the frames are frameBytes each (i.e. the rows are not padded), a partially filled chunk is still written at its full size
+//       4, if indexOffset is 0 the recording was not closed cleanly, the index can be rebuilt by scanning the chunks for valid chunk headers
+//          i.e. a crash loses the chunks that had not been written, see FrameRecorder for how many that can be
+//       5, all values are host endian (little endian on the supported platforms)
+//       6, version 2 added the camera frame count to each index entry, i.e. so a replayed frame's meta data is that of the live frame
+//
+constexpr size_t RECORDING_BLOCK_SIZE = 4096;
+constexpr uint32_t RECORDING_VERSION = 2;
+constexpr char RECORDING_MAGIC[8] = {'G', 'I', 'G', 'E', 'R', 'A', 'W', '2'};
+constexpr char RECORDING_CHUNK_MAGIC[4] = {'C', 'H', 'N', 'K'};
+constexpr char RECORDING_INDEX_MAGIC[4] = {'G', 'I', 'D', 'X'};
+
+struct RecordingHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t headerBytes;
+    int32_t width;
+    int32_t height;
+    int32_t type;
+    int32_t bitDepth;
+    uint64_t rowBytes;
+    uint64_t frameBytes;
+    uint32_t framesPerChunk;
+    uint32_t chunkHeaderBytes;
+    uint64_t chunkBytes;
+    double frameRate;
+    uint64_t indexOffset;
+    uint64_t frameCount;
+    char format[32];
+    char caps[2048];
+};
+
+struct RecordingIndexEntry
+{
+    uint64_t offset;
+    uint64_t cameraTimestamp;
+    uint64_t sequence;
+    uint64_t cameraFrameCount;
+};
+
+struct RecordingChunkHeader
+{
+    char magic[4];
+    uint32_t frameCount;
+    uint64_t chunkIndex;
+};
+
+struct RecordingIndexHeader
+{
+    char magic[4];
+    uint32_t reserved;
+    uint64_t frameCount;
+};
+
+static_assert(sizeof(RecordingHeader) <= RECORDING_BLOCK_SIZE, "The recording header must fit in a single block");
+
+inline size_t recordingBlocks(const size_t bytes)
+{
+    // rounds up to a whole number of blocks
+    //
+    return ((bytes + RECORDING_BLOCK_SIZE - 1) / RECORDING_BLOCK_SIZE) * RECORDING_BLOCK_SIZE;
+}
+
+#endif
@@ -0,0 +1,225 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "replay-source.hpp"
+
+ReplaySource::ReplaySource(const Options& replayOptions):
+    options(replayOptions)
+{
+    if ((options.pacing == Pacing::SCALED) && !(options.rateScale > 0.0)) throw std::string("Unable to replay, rateScale must be greater than 0");
+
+    const int32_t fd = open(options.path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::string("Unable to open the recording: ") + options.path + ", reason: " + strerror(errno);
+
+    struct stat status;
+    if ((fstat(fd, &status) != 0) || (size_t(status.st_size) < RECORDING_BLOCK_SIZE))
+    {
+        ::close(fd);
+        throw std::string("Unable to replay, not a recording: ") + options.path;
+    }
+
+    // notes 1, the file descriptor is not needed once mapped, the mapping is released when the last zero copy frame is released
+    //       2, MAP_PRIVATE, so that writing to a zero copy frame copies the page rather than faulting (the file is opened read only)
+    //
+    size = status.st_size;
+    void* mapped = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) throw std::string("Unable to map the recording: ") + options.path + ", reason: " + strerror(errno);
+
+    const size_t mappedSize = size;
+    mapping = std::shared_ptr<void>(mapped, [mappedSize](void* address) { munmap(address, mappedSize); });
+    data = static_cast<const uint8_t*>(mapped);
+    madvise(mapped, size, MADV_SEQUENTIAL);
+
+    const auto& header = *reinterpret_cast<const RecordingHeader*>(data);
+    if ((memcmp(header.magic, RECORDING_MAGIC, sizeof(header.magic)) != 0) || (header.version != RECORDING_VERSION)) throw std::string("Unable to replay, unsupported recording: ") + options.path;
+
+    // the frame format is parsed from the recorded caps, so that the bayer pattern etc. are exactly as they were when recorded
+    // note, the recorded frames are never padded
+    //
+    const auto caps = std::string(header.caps, strnlen(header.caps, sizeof(header.caps)));
+    GstCaps* parsedCaps = gst_caps_from_string(caps.c_str());
+    const bool parsed = FrameFormat::fromCaps(parsedCaps, frameFormat);
+    if (parsedCaps != nullptr) gst_caps_unref(parsedCaps);
+
+    if (!parsed || (frameFormat.width != header.width) || (frameFormat.height != header.height) || (frameFormat.type != header.type)) throw std::string("Unable to replay, the recorded caps are not supported: ") + caps;
+
+    frameFormat.stride = frameFormat.rowBytes;
+    frameFormat.offset = 0;
+    frameBytes = header.frameBytes;
+    if (frameBytes < (frameFormat.rowBytes * frameFormat.height)) throw std::string("Unable to replay, inconsistent frame size: ") + options.path;
+
+    loadIndex(header);
+}
+
+void ReplaySource::loadIndex(const RecordingHeader& header)
+{
+    const auto valid = [this](const RecordingIndexEntry& entry) {
+        return (entry.offset >= RECORDING_BLOCK_SIZE) && (entry.offset <= size) && (frameBytes <= (size - entry.offset));
+    };
+
+    // a cleanly closed recording has an index, see FrameRecorder::close()
+    //
+    if ((header.indexOffset != 0) && ((header.indexOffset + sizeof(RecordingIndexHeader)) <= size))
+    {
+        const auto& indexHeader = *reinterpret_cast<const RecordingIndexHeader*>(data + header.indexOffset);
+        const size_t available = (size - header.indexOffset - sizeof(RecordingIndexHeader)) / sizeof(RecordingIndexEntry);
+        if ((memcmp(indexHeader.magic, RECORDING_INDEX_MAGIC, sizeof(indexHeader.magic)) == 0) && (indexHeader.frameCount <= available))
+        {
+            const auto* entries = reinterpret_cast<const RecordingIndexEntry*>(data + header.indexOffset + sizeof(RecordingIndexHeader));
+            index.assign(entries, entries + indexHeader.frameCount);
+        }
+    }
+
+    // otherwise rebuild it from the chunk headers, stopping at the 1st chunk that was not (completely) written
+    //
+    if (index.empty() && (header.chunkBytes > 0))
+    {
+        for (uint64_t offset = RECORDING_BLOCK_SIZE, chunkIndex = 0; (offset + header.chunkBytes) <= size; offset += header.chunkBytes, chunkIndex++)
+        {
+            const auto& chunkHeader = *reinterpret_cast<const RecordingChunkHeader*>(data + offset);
+            if ((memcmp(chunkHeader.magic, RECORDING_CHUNK_MAGIC, sizeof(chunkHeader.magic)) != 0) || (chunkHeader.chunkIndex != chunkIndex) || (chunkHeader.frameCount > header.framesPerChunk)) break;
+
+            const auto* entries = reinterpret_cast<const RecordingIndexEntry*>(data + offset + sizeof(RecordingChunkHeader));
+            index.insert(index.end(), entries, entries + chunkHeader.frameCount);
+        }
+    }
+
+    if (!std::all_of(index.begin(), index.end(), valid)) throw std::string("Unable to replay, the recording index is corrupt: ") + options.path;
+}
+
+const FrameFormat& ReplaySource::getFrameFormat() const
+{
+    return frameFormat;
+}
+
+size_t ReplaySource::getFrameCount() const
+{
+    return index.size();
+}
+
+bool ReplaySource::seek(const uint64_t cameraTimestamp)
+{
+    // notes 1, the next frame played back is the 1st frame recorded at, or after, the camera timestamp
+    //       2, the frames are recorded in camera timestamp order, so this is a binary search of the index
+    //       3, may be called while playing, the pacing restarts from the new position
+    //
+    const auto found = std::lower_bound(index.begin(), index.end(), cameraTimestamp, [](const RecordingIndexEntry& entry, const uint64_t timestamp) {
+        return entry.cameraTimestamp < timestamp;
+    });
+
+    if (found == index.end()) return false;
+
+    seekPosition.store(found - index.begin());
+    return true;
+}
+
+bool ReplaySource::start(FrameHandler frameHandler, FinishedHandler finishedHandler)
+{
+    // note, restarts from the current position, or from the beginning if the previous playback reached the end
+    //
+    if (playing.load()) return false;
+
+    stop();
+    stopping = false;
+    if (position >= index.size()) position = 0;
+    playing.store(true);
+    playerThread = std::thread(&ReplaySource::player, this, std::move(frameHandler), std::move(finishedHandler));
+
+    return true;
+}
+
+void ReplaySource::stop()
+{
+    {
+        std::scoped_lock<std::mutex> lock(playerMutex);
+        stopping = true;
+    }
+
+    playerCondition.notify_one();
+    if (playerThread.joinable()) playerThread.join();
+}
+
+void ReplaySource::player(FrameHandler frameHandler, FinishedHandler finishedHandler)
+{
+    // the pacing clock, i.e. the steady clock time at which the frame with the base camera timestamp is played back
+    // note, rebased after a seek, a loop or if the camera timestamps go backwards
+    //
+    auto baseTime = std::chrono::steady_clock::now();
+    uint64_t baseTimestamp = 0;
+    bool rebase = true;
+
+    while (true)
+    {
+        const size_t requested = seekPosition.exchange(NO_SEEK);
+        if (requested != NO_SEEK)
+        {
+            position = requested;
+            rebase = true;
+        }
+
+        if (position >= index.size())
+        {
+            if (!options.loop || index.empty()) break;
+
+            position = 0;
+            rebase = true;
+        }
+
+        const RecordingIndexEntry& entry = index[position];
+        if (rebase || (entry.cameraTimestamp < baseTimestamp))
+        {
+            baseTime = std::chrono::steady_clock::now();
+            baseTimestamp = entry.cameraTimestamp;
+            rebase = false;
+        }
+
+        // waits until the frame is due, or until stopped
+        //
+        auto due = baseTime;
+        if (options.pacing != Pacing::AS_FAST_AS_POSSIBLE)
+        {
+            double interval = double(entry.cameraTimestamp - baseTimestamp);
+            if (options.pacing == Pacing::SCALED) interval /= options.rateScale;
+            due += std::chrono::nanoseconds(uint64_t(interval));
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(playerMutex);
+            if (playerCondition.wait_until(lock, due, [this] { return stopping; })) break;
+        }
+
+        // notes 1, the mapping is a private copy on write mapping, so a write to a zero copy frame is only seen by this process and never reaches the file
+        //          but it is seen by any later replay of the same frame, so the zero copy frames should still be treated as read only (as for any zero copy frame)
+        //       2, the camera frame count is that recorded with the frame, the frame rate is derived from the timestamps
+        //
+        FrameMetaData metaData;
+        metaData.cameraTimestamp = entry.cameraTimestamp;
+        metaData.cameraFrameCount = entry.cameraFrameCount;
+        metaData.cameraFrameRate = frameFormat.frameRate;
+        if ((position > 0) && (entry.cameraTimestamp > index[position - 1].cameraTimestamp)) metaData.cameraFrameRate = 1.0e9 / double(entry.cameraTimestamp - index[position - 1].cameraTimestamp);
+
+        const auto frame = cv::Mat(frameFormat.height, frameFormat.width, frameFormat.type, const_cast<uint8_t*>(data + entry.offset));
+        frameHandler(frame, metaData, mapping);
+        position++;
+    }
+
+    playing.store(false);
+    if (finishedHandler) finishedHandler();
+}
+
+ReplaySource::~ReplaySource()
+{
+    stop();
+}
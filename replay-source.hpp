@@ -0,0 +1,87 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#ifndef H_REPLAY_SOURCE
+#define H_REPLAY_SOURCE
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "frame-format.hpp"
+#include "frame-meta-data.hpp"
+#include "recording-format.hpp"
+
+// plays back a recording made by FrameRecorder, see recording-format.hpp
+// notes 1, the recording is memory mapped and each frame is passed to the frame handler as a cv::Mat header for the mapping
+//          i.e. nothing is copied, the owner keeps the mapping alive for as long as any zero copy frame references it
+//          the mapping is private and writable (copy on write), so a zero copy frame can be processed in place as with a live capture
+//          the file is never modified, but the written pages are kept by the mapping, i.e. a looped replay sees the frame as it was modified
+//       2, AS_FAST_AS_POSSIBLE, the frames are played back to back, i.e. for throughput testing
+//          CAMERA_TIMESTAMPS, the frames are played back at the intervals given by their recorded camera timestamps
+//          SCALED, as CAMERA_TIMESTAMPS but with the intervals divided by rateScale, i.e. 2.0 plays back at twice the recorded rate
+//       3, if the recording was not closed cleanly (i.e. it has no index) the index is rebuilt by scanning the chunk headers
+//       4, the frames are played back on a dedicated thread, which stands in for the gstreamer streaming thread
+//
+class ReplaySource
+{
+    public:
+        enum class Pacing { AS_FAST_AS_POSSIBLE, CAMERA_TIMESTAMPS, SCALED };
+
+        struct Options
+        {
+            std::string path;
+            Pacing pacing = Pacing::CAMERA_TIMESTAMPS;
+            double rateScale = 1.0;
+            bool loop = false;
+        };
+
+        using FrameHandler = std::function<void(const cv::Mat& frame, const FrameMetaData& metaData, const std::shared_ptr<void>& owner)>;
+        using FinishedHandler = std::function<void()>;
+
+    private:
+        static constexpr size_t NO_SEEK = SIZE_MAX;
+
+        const Options options;
+        std::shared_ptr<void> mapping;
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+        FrameFormat frameFormat;
+        size_t frameBytes = 0;
+        std::vector<RecordingIndexEntry> index;
+
+        size_t position = 0;
+        std::atomic<size_t> seekPosition = NO_SEEK;
+        std::thread playerThread;
+        std::mutex playerMutex;
+        std::condition_variable playerCondition;
+        bool stopping = false;
+        std::atomic<bool> playing = false;
+
+    public:
+        ReplaySource(const Options& replayOptions);
+
+        const FrameFormat& getFrameFormat() const;
+        size_t getFrameCount() const;
+        bool seek(const uint64_t cameraTimestamp);
+
+        bool start(FrameHandler frameHandler, FinishedHandler finishedHandler);
+        void stop();
+
+        ~ReplaySource();
+
+    private:
+        void loadIndex(const RecordingHeader& header);
+        void player(FrameHandler frameHandler, FinishedHandler finishedHandler);
+};
+
+#endif
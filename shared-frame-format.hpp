@@ -0,0 +1,116 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#ifndef H_SHARED_FRAME_FORMAT
+#define H_SHARED_FRAME_FORMAT
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// the POSIX shared memory layout used to publish frames to other processes, see SharedFramePublisher and SharedFrameSubscriber
+// notes 1, the segment is a SharedFrameHeader, followed by slotCount fixed size slots, each a SharedFrameSlot followed by the frame
+//          the frames are frameBytes each (i.e. the rows are not padded) and every slot starts on a SHARED_FRAME_ALIGNMENT boundary
+//       2, frame n (counting from 0) is written to slot n % slotCount, each slot is protected by a seqlock (its sequence)
+//          the sequence is odd while the frame is being written and 2n + 2 once frame n is complete, i.e. it is never 0 once written
+//       3, published is the number of frames published, so published - 1 is the newest frame and published - slotCount the oldest still held
+//          a subscriber that falls more than slotCount frames behind has been overrun, it never stalls the publisher
+//       4, wakeCount is a futex word, incremented once for each published frame and when the publisher closes
+//          it is only woken if waiters is non zero, i.e. each subscriber counts itself in waiters while it is blocked on wakeCount
+//       5, the header's magic is written last, so a subscriber that finds it knows the rest of the header is valid
+//       6, all values are host endian, the atomics are lock free and so are address free, i.e. they can be shared between processes
+//       7, the header is padded to a whole number of pages, so that a subscriber can map it writable (i.e. for waiters) and the slots read only
+//       8, publisherPid is the publishing process, so that a subscriber can detect a publisher that exited without closing (i.e. crashed)
+//
+constexpr size_t SHARED_FRAME_ALIGNMENT = 64;
+constexpr uint32_t SHARED_FRAME_VERSION = 2;
+constexpr char SHARED_FRAME_MAGIC[8] = {'G', 'I', 'G', 'E', 'S', 'H', 'M', '2'};
+
+struct SharedFrameHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t slotCount;
+    uint64_t headerBytes;
+    uint64_t slotBytes;
+    uint64_t slotHeaderBytes;
+    int32_t width;
+    int32_t height;
+    int32_t type;
+    int32_t bitDepth;
+    uint64_t rowBytes;
+    uint64_t frameBytes;
+    double frameRate;
+    int32_t publisherPid;
+    char format[32];
+    char caps[2048];
+
+    alignas(SHARED_FRAME_ALIGNMENT) std::atomic<uint64_t> published;
+    std::atomic<uint32_t> wakeCount;
+    std::atomic<uint32_t> closed;
+    std::atomic<uint32_t> waiters;
+};
+
+struct SharedFrameSlot
+{
+    std::atomic<uint64_t> sequence;
+    uint64_t frameSequence;
+    uint64_t arrivalTime;
+    uint64_t cameraTimestamp;
+    uint64_t cameraFrameCount;
+    uint64_t cameraFramesDropped;
+    double cameraFrameRate;
+    uint64_t settingsGeneration;
+    uint64_t hostTimestamp;
+    uint64_t hostRealtime;
+    int64_t transportLatency;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free, "The shared frame atomics must be lock free");
+
+inline size_t sharedFrameAlign(const size_t bytes)
+{
+    // rounds up to a whole number of cache lines
+    //
+    return ((bytes + SHARED_FRAME_ALIGNMENT - 1) / SHARED_FRAME_ALIGNMENT) * SHARED_FRAME_ALIGNMENT;
+}
+
+inline size_t sharedFramePages(const size_t bytes)
+{
+    // rounds up to a whole number of pages, see note 7
+    //
+    const size_t pageBytes = sysconf(_SC_PAGESIZE);
+    return ((bytes + pageBytes - 1) / pageBytes) * pageBytes;
+}
+
+inline void sharedFrameWake(std::atomic<uint32_t>& word)
+{
+    // note, not FUTEX_PRIVATE_FLAG, the waiters are in other processes
+    //
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+}
+
+inline bool sharedFrameWait(std::atomic<uint32_t>& word, const uint32_t expected, const std::chrono::nanoseconds* timeout)
+{
+    // returns false if the wait timed out, otherwise it was woken (or the word had already changed), i.e. the caller must re-check
+    //
+    struct timespec relative;
+    if (timeout != nullptr)
+    {
+        relative.tv_sec = timeout->count() / 1000000000;
+        relative.tv_nsec = timeout->count() % 1000000000;
+    }
+
+    const long result = syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, expected, (timeout != nullptr) ? &relative : nullptr, nullptr, 0);
+    return (result == 0) || (errno != ETIMEDOUT);
+}
+
+#endif
@@ -0,0 +1,160 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#include <cstring>
+#include <new>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "shared-frame-publisher.hpp"
+
+SharedFramePublisher::SharedFramePublisher(const std::string& segmentName, const FrameFormat& format, const Options& options):
+    name((!segmentName.empty() && (segmentName[0] == '/')) ? segmentName : "/" + segmentName), frameFormat(format)
+{
+    if (!frameFormat.isValid()) throw std::string("Unable to publish, the frame format is not known");
+    if (options.slotCount < 2) throw std::string("Unable to publish, slotCount must be at least 2");
+
+    const size_t headerBytes = sharedFramePages(sizeof(SharedFrameHeader));
+    const size_t slotHeaderBytes = sharedFrameAlign(sizeof(SharedFrameSlot));
+    const size_t frameBytes = frameFormat.rowBytes * frameFormat.height;
+    const size_t slotBytes = sharedFrameAlign(slotHeaderBytes + frameBytes);
+    segmentBytes = headerBytes + (options.slotCount * slotBytes);
+
+    // notes 1, any existing segment is stale (i.e. left behind by a publisher that crashed), the subscribers that still have it mapped are unaffected
+    //       2, the subscribers open the segment read write (i.e. to count themselves as waiters), so they must be the same user or group
+    //
+    shm_unlink(name.c_str());
+    const int32_t fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0660);
+    if (fd < 0) throw std::string("Unable to create the shared memory segment: ") + name + ", reason: " + strerror(errno);
+
+    if (ftruncate(fd, segmentBytes) != 0)
+    {
+        const auto reason = std::string(strerror(errno));
+        close(fd);
+        shm_unlink(name.c_str());
+
+        throw std::string("Unable to size the shared memory segment: ") + name + ", reason: " + reason;
+    }
+
+    void* mapped = mmap(nullptr, segmentBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+    close(fd);
+
+    if (mapped == MAP_FAILED)
+    {
+        const auto reason = std::string(strerror(errno));
+        shm_unlink(name.c_str());
+
+        throw std::string("Unable to map the shared memory segment: ") + name + ", reason: " + reason;
+    }
+
+    // touch every page (MAP_POPULATE is only a hint), the slot sequences are therefore all 0, i.e. never written
+    //
+    segment = static_cast<uint8_t*>(mapped);
+    memset(segment, 0, segmentBytes);
+
+    header = new (segment) SharedFrameHeader();
+    header->version = SHARED_FRAME_VERSION;
+    header->slotCount = options.slotCount;
+    header->headerBytes = headerBytes;
+    header->slotBytes = slotBytes;
+    header->slotHeaderBytes = slotHeaderBytes;
+    header->width = frameFormat.width;
+    header->height = frameFormat.height;
+    header->type = frameFormat.type;
+    header->bitDepth = frameFormat.bitDepth;
+    header->rowBytes = frameFormat.rowBytes;
+    header->frameBytes = frameBytes;
+    header->frameRate = frameFormat.frameRate;
+    header->publisherPid = getpid();
+    strncpy(header->format, frameFormat.format.c_str(), sizeof(header->format) - 1);
+    strncpy(header->caps, frameFormat.caps.c_str(), sizeof(header->caps) - 1);
+    header->published.store(0);
+    header->wakeCount.store(0);
+    header->closed.store(0);
+    header->waiters.store(0);
+
+    for (uint32_t i = 0; i < options.slotCount; i++) new (segment + headerBytes + (i * slotBytes)) SharedFrameSlot();
+
+    // the magic is written last, see shared-frame-format.hpp
+    //
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(header->magic, SHARED_FRAME_MAGIC, sizeof(header->magic));
+}
+
+const std::string& SharedFramePublisher::getName() const
+{
+    return name;
+}
+
+bool SharedFramePublisher::publish(const cv::Mat& frame, const FrameMetaData& metaData)
+{
+    // note, as for the recorder, the frame must match the format that publishing was started with, i.e. the caps have not changed
+    //
+    if ((frame.rows != frameFormat.height) || (frame.cols != frameFormat.width) || (frame.type() != frameFormat.type))
+    {
+        dropped++;
+        return false;
+    }
+
+    const uint64_t frameIndex = header->published.load(std::memory_order_relaxed);
+    uint8_t* slotBase = segment + header->headerBytes + ((frameIndex % header->slotCount) * header->slotBytes);
+    auto* slot = reinterpret_cast<SharedFrameSlot*>(slotBase);
+
+    // the seqlock write, i.e. odd while the slot is being written
+    // note, the release fence orders the odd sequence before any of the slot's data, see SharedFrameSubscriber::readSlot()
+    //
+    slot->sequence.store((2 * frameIndex) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot->frameSequence = metaData.sequence;
+    slot->arrivalTime = metaData.arrivalTime;
+    slot->cameraTimestamp = metaData.cameraTimestamp;
+    slot->cameraFrameCount = metaData.cameraFrameCount;
+    slot->cameraFramesDropped = metaData.cameraFramesDropped;
+    slot->cameraFrameRate = metaData.cameraFrameRate;
+    slot->settingsGeneration = metaData.settingsGeneration;
+    slot->hostTimestamp = metaData.hostTimestamp;
+    slot->hostRealtime = metaData.hostRealtime;
+    slot->transportLatency = metaData.transportLatency;
+
+    // note, copyTo() removes any row padding, the destination is a cv::Mat header for the slot so nothing is allocated
+    //
+    auto destination = cv::Mat(frameFormat.height, frameFormat.width, frameFormat.type, slotBase + header->slotHeaderBytes);
+    frame.copyTo(destination);
+
+    slot->sequence.store((2 * frameIndex) + 2, std::memory_order_release);
+    header->published.store(frameIndex + 1, std::memory_order_release);
+
+    // notes 1, the futex is only woken if a subscriber is blocked on it, i.e. no syscall per frame when every subscriber is busy (or there are none)
+    //       2, both are sequentially consistent, i.e. either the waiter is seen here or its FUTEX_WAIT sees the new wakeCount, see SharedFrameSubscriber
+    //
+    header->wakeCount.fetch_add(1);
+    if (header->waiters.load() != 0) sharedFrameWake(header->wakeCount);
+    published++;
+
+    return true;
+}
+
+SharedFramePublisher::Statistics SharedFramePublisher::getStatistics() const
+{
+    auto statistics = Statistics();
+    statistics.published = published.load();
+    statistics.dropped = dropped.load();
+
+    return statistics;
+}
+
+SharedFramePublisher::~SharedFramePublisher()
+{
+    // note, any waiting subscribers are woken so that they can see the publisher has closed
+    //
+    header->closed.store(1, std::memory_order_release);
+    header->wakeCount.fetch_add(1, std::memory_order_release);
+    sharedFrameWake(header->wakeCount);
+
+    munmap(segment, segmentBytes);
+    shm_unlink(name.c_str());
+}
@@ -0,0 +1,58 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#ifndef H_SHARED_FRAME_PUBLISHER
+#define H_SHARED_FRAME_PUBLISHER
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include <opencv2/opencv.hpp>
+
+#include "frame-format.hpp"
+#include "frame-meta-data.hpp"
+#include "shared-frame-format.hpp"
+
+// publishes frames into a POSIX shared memory ring, so that several processes can consume the frames of a single camera
+// notes 1, publish() is called by the handler(), it copies the frame into the next slot and never blocks or waits for the subscribers
+//          i.e. the oldest slot is always overwritten, a subscriber that falls behind detects the overrun, see shared-frame-format.hpp
+//       2, the segment is created (replacing any stale segment of the same name) and fully touched up front, so publish() never page faults
+//       3, the segment is unlinked when the publisher is destroyed, subscribers that still have it mapped see it as closed
+//
+class SharedFramePublisher
+{
+    public:
+        struct Options
+        {
+            uint32_t slotCount = 8;
+        };
+
+        struct Statistics
+        {
+            uint64_t published = 0;
+            uint64_t dropped = 0;
+        };
+
+    private:
+        const std::string name;
+        const FrameFormat frameFormat;
+        size_t segmentBytes = 0;
+        uint8_t* segment = nullptr;
+        SharedFrameHeader* header = nullptr;
+
+        std::atomic<uint64_t> published = 0;
+        std::atomic<uint64_t> dropped = 0;
+
+    public:
+        SharedFramePublisher(const std::string& segmentName, const FrameFormat& format, const Options& options);
+
+        const std::string& getName() const;
+        bool publish(const cv::Mat& frame, const FrameMetaData& metaData);
+        Statistics getStatistics() const;
+
+        ~SharedFramePublisher();
+};
+
+#endif
@@ -0,0 +1,237 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "shared-frame-subscriber.hpp"
+
+SharedFrameSubscriber::SharedFrameSubscriber(const std::string& segmentName):
+    SharedFrameSubscriber(segmentName, Options())
+{
+}
+
+SharedFrameSubscriber::SharedFrameSubscriber(const std::string& segmentName, const Options& subscriberOptions):
+    name((!segmentName.empty() && (segmentName[0] == '/')) ? segmentName : "/" + segmentName), options(subscriberOptions)
+{
+    // note, opened read write as the subscriber counts itself in the header's waiters, see shared-frame-format.hpp
+    //
+    const int32_t fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) throw std::string("Unable to open the shared memory segment: ") + name + ", reason: " + strerror(errno);
+
+    struct stat status;
+    const bool sized = (fstat(fd, &status) == 0) && (static_cast<size_t>(status.st_size) >= sharedFramePages(sizeof(SharedFrameHeader)));
+    segmentBytes = sized ? status.st_size : 0;
+
+    void* mapped = sized ? mmap(nullptr, segmentBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+
+    if (mapped == MAP_FAILED) throw std::string("Unable to map the shared memory segment: ") + name;
+
+    segment = static_cast<uint8_t*>(mapped);
+    header = reinterpret_cast<SharedFrameHeader*>(segment);
+
+    // notes 1, the magic is written last by the publisher, see shared-frame-format.hpp
+    //       2, the slots are then made read only, the header is padded to whole pages so that only it remains writable
+    //
+    const bool valid = (memcmp(header->magic, SHARED_FRAME_MAGIC, sizeof(header->magic)) == 0) && (header->version == SHARED_FRAME_VERSION);
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    const bool complete = valid && (header->headerBytes == sharedFramePages(header->headerBytes)) && (segmentBytes >= (header->headerBytes + (header->slotCount * header->slotBytes)));
+    if (!complete || (mprotect(segment + header->headerBytes, segmentBytes - header->headerBytes, PROT_READ) != 0))
+    {
+        munmap(segment, segmentBytes);
+        throw std::string("Unable to subscribe, unsupported or incomplete shared memory segment: ") + name;
+    }
+
+    // as for the replay, the frame format is parsed from the published caps (i.e. gst_init() must have been called), the published frames are never padded
+    //
+    const auto caps = std::string(header->caps, strnlen(header->caps, sizeof(header->caps)));
+    GstCaps* parsedCaps = gst_caps_from_string(caps.c_str());
+    const bool parsed = FrameFormat::fromCaps(parsedCaps, frameFormat);
+    if (parsedCaps != nullptr) gst_caps_unref(parsedCaps);
+
+    if (!parsed || (frameFormat.width != header->width) || (frameFormat.height != header->height) || (frameFormat.type != header->type))
+    {
+        munmap(segment, segmentBytes);
+        throw std::string("Unable to subscribe, the published caps are not supported: ") + caps;
+    }
+
+    frameFormat.stride = frameFormat.rowBytes;
+    frameFormat.offset = 0;
+
+    // note, only frames published after subscribing are grabbed
+    //
+    nextFrame = header->published.load(std::memory_order_acquire);
+}
+
+bool SharedFrameSubscriber::grab(cv::Mat& frame)
+{
+    return waitForFrame(frame, nullptr);
+}
+
+bool SharedFrameSubscriber::tryGrab(cv::Mat& frame, const std::chrono::milliseconds timeout)
+{
+    return waitForFrame(frame, &timeout);
+}
+
+bool SharedFrameSubscriber::waitForFrame(cv::Mat& frame, const std::chrono::milliseconds* timeout)
+{
+    const auto deadline = std::chrono::steady_clock::now() + (timeout ? *timeout : std::chrono::milliseconds(0));
+    while (true)
+    {
+        // note, wakeCount must be read before published, so that a frame published in between is not missed by the futex wait
+        //
+        const uint32_t wakeCount = header->wakeCount.load(std::memory_order_acquire);
+        const uint64_t published = header->published.load(std::memory_order_acquire);
+        if (published > nextFrame)
+        {
+            // the newest frame (LATEST) or the next frame, unless it has already been overwritten, in which case the oldest frame still held
+            //
+            uint64_t frameIndex = nextFrame;
+            if (options.policy == GrabPolicy::LATEST) frameIndex = published - 1;
+            else if ((published - nextFrame) > header->slotCount)
+            {
+                frameIndex = published - header->slotCount;
+                statistics.overruns++;
+            }
+
+            statistics.missed += frameIndex - nextFrame;
+            nextFrame = frameIndex + 1;
+
+            if (readSlot(frameIndex, frame))
+            {
+                statistics.received++;
+                return true;
+            }
+
+            // overwritten while it was being read, i.e. overrun
+            //
+            statistics.missed++;
+            statistics.overruns++;
+            continue;
+        }
+
+        if (header->closed.load(std::memory_order_acquire)) return false;
+
+        if (timeout == nullptr)
+        {
+            // note, the wait is bounded so that a publisher that crashed (i.e. never sets closed) is detected rather than waiting forever
+            //
+            const auto interval = std::chrono::duration_cast<std::chrono::nanoseconds>(options.livenessInterval);
+            if (!wait(wakeCount, &interval) && !isPublisherAlive()) return false;
+            continue;
+        }
+
+        const auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - std::chrono::steady_clock::now());
+        if ((remaining.count() <= 0) || !wait(wakeCount, &remaining)) return false;
+    }
+}
+
+bool SharedFrameSubscriber::wait(const uint32_t wakeCount, const std::chrono::nanoseconds* timeout)
+{
+    // the publisher only wakes the futex if a subscriber is waiting, see SharedFramePublisher::publish()
+    // note, waiters is incremented (sequentially consistent) before the FUTEX_WAIT compares wakeCount, i.e. a frame published in between is never missed
+    //
+    header->waiters.fetch_add(1);
+    const bool woken = sharedFrameWait(header->wakeCount, wakeCount, timeout);
+    header->waiters.fetch_sub(1);
+
+    return woken;
+}
+
+bool SharedFrameSubscriber::isPublisherAlive() const
+{
+    // note, EPERM means the process exists but belongs to another user
+    //
+    return (kill(header->publisherPid, 0) == 0) || (errno != ESRCH);
+}
+
+bool SharedFrameSubscriber::readSlot(const uint64_t frameIndex, cv::Mat& frame)
+{
+    // the seqlock read, returns false if the slot no longer holds the frame (or was overwritten whilst it was being read)
+    //
+    uint8_t* slotBase = segment + header->headerBytes + ((frameIndex % header->slotCount) * header->slotBytes);
+    const auto* slot = reinterpret_cast<const SharedFrameSlot*>(slotBase);
+    const uint64_t expected = (2 * frameIndex) + 2;
+    if (slot->sequence.load(std::memory_order_acquire) != expected) return false;
+
+    auto metaData = FrameMetaData();
+    metaData.sequence = slot->frameSequence;
+    metaData.arrivalTime = slot->arrivalTime;
+    metaData.cameraTimestamp = slot->cameraTimestamp;
+    metaData.cameraFrameCount = slot->cameraFrameCount;
+    metaData.cameraFramesDropped = slot->cameraFramesDropped;
+    metaData.cameraFrameRate = slot->cameraFrameRate;
+    metaData.settingsGeneration = slot->settingsGeneration;
+    metaData.hostTimestamp = slot->hostTimestamp;
+    metaData.hostRealtime = slot->hostRealtime;
+    metaData.transportLatency = slot->transportLatency;
+
+    // note, a zero copy frame is only a cv::Mat header for the slot, the mapping is held until the subscriber is destroyed
+    //
+    const auto view = cv::Mat(frameFormat.height, frameFormat.width, frameFormat.type, slotBase + header->slotHeaderBytes);
+    if (options.zeroCopy) frame = view;
+    else view.copyTo(frame);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot->sequence.load(std::memory_order_relaxed) != expected) return false;
+
+    frameMetaData = metaData;
+    grabbedSlot = slot;
+    grabbedSequence = expected;
+
+    return true;
+}
+
+bool SharedFrameSubscriber::isFrameValid() const
+{
+    // note, a zero copy frame should be checked once it has been processed, i.e. to discard any results derived from an overwritten frame
+    //
+    if (grabbedSlot == nullptr) return false;
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return grabbedSlot->sequence.load(std::memory_order_relaxed) == grabbedSequence;
+}
+
+bool SharedFrameSubscriber::isClosed() const
+{
+    return (header->closed.load(std::memory_order_acquire) != 0) || !isPublisherAlive();
+}
+
+const FrameMetaData& SharedFrameSubscriber::getFrameMetaData() const
+{
+    return frameMetaData;
+}
+
+const FrameFormat& SharedFrameSubscriber::getFrameFormat() const
+{
+    return frameFormat;
+}
+
+uint64_t SharedFrameSubscriber::getCameraTimestamp() const
+{
+    return frameMetaData.cameraTimestamp;
+}
+
+double SharedFrameSubscriber::getCameraFrameRate() const
+{
+    return frameMetaData.cameraFrameRate;
+}
+
+SharedFrameSubscriber::Statistics SharedFrameSubscriber::getStatistics() const
+{
+    return statistics;
+}
+
+SharedFrameSubscriber::~SharedFrameSubscriber()
+{
+    munmap(segment, segmentBytes);
+}
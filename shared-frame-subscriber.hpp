@@ -0,0 +1,86 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#ifndef H_SHARED_FRAME_SUBSCRIBER
+#define H_SHARED_FRAME_SUBSCRIBER
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include <opencv2/opencv.hpp>
+
+#include "frame-format.hpp"
+#include "frame-meta-data.hpp"
+#include "shared-frame-format.hpp"
+
+// consumes the frames published by another process's GigEVideoCapture, see GigEVideoCapture::startPublishing()
+// notes 1, the slots are mapped read only, so a subscriber can never affect the publisher or the other subscribers (only the header's waiter count is written)
+//       2, by default the grabbed frames are zero copy views of the shared memory slot, they are valid until the publisher overwrites the slot
+//          i.e. after slotCount more frames, isFrameValid() returns false if the grabbed frame has since been overwritten
+//       3, a subscriber that falls more than slotCount frames behind skips to the oldest frame still held, the skipped frames are counted as missed
+//       4, grab() returns false once the publisher has closed (i.e. the capture was stopped or the process exited cleanly)
+//          or, checked every livenessInterval while waiting, once the publishing process no longer exists (i.e. it crashed)
+//       5, the liveness check uses the publisher's pid, so the publisher and subscribers must share a pid namespace
+//
+class SharedFrameSubscriber
+{
+    public:
+        // notes 1, LATEST, returns the newest published frame and skips any older ones
+        //       2, QUEUED, returns the published frames in order, unless overrun
+        //
+        enum class GrabPolicy { LATEST, QUEUED };
+
+        struct Options
+        {
+            GrabPolicy policy = GrabPolicy::QUEUED;
+            bool zeroCopy = true;
+            std::chrono::milliseconds livenessInterval = std::chrono::milliseconds(1000);
+        };
+
+        struct Statistics
+        {
+            uint64_t received = 0;
+            uint64_t missed = 0;
+            uint64_t overruns = 0;
+        };
+
+    private:
+        const std::string name;
+        const Options options;
+        size_t segmentBytes = 0;
+        uint8_t* segment = nullptr;
+        SharedFrameHeader* header = nullptr;
+        FrameFormat frameFormat;
+
+        uint64_t nextFrame = 0;
+        const SharedFrameSlot* grabbedSlot = nullptr;
+        uint64_t grabbedSequence = 0;
+        FrameMetaData frameMetaData;
+        Statistics statistics;
+
+    public:
+        SharedFrameSubscriber(const std::string& segmentName);
+        SharedFrameSubscriber(const std::string& segmentName, const Options& subscriberOptions);
+
+        bool grab(cv::Mat& frame);
+        bool tryGrab(cv::Mat& frame, const std::chrono::milliseconds timeout);
+        bool isFrameValid() const;
+        bool isClosed() const;
+        const FrameMetaData& getFrameMetaData() const;
+        const FrameFormat& getFrameFormat() const;
+        uint64_t getCameraTimestamp() const;
+        double getCameraFrameRate() const;
+        Statistics getStatistics() const;
+
+        ~SharedFrameSubscriber();
+
+    private:
+        bool waitForFrame(cv::Mat& frame, const std::chrono::milliseconds* timeout);
+        bool readSlot(const uint64_t frameIndex, cv::Mat& frame);
+        bool wait(const uint32_t wakeCount, const std::chrono::nanoseconds* timeout);
+        bool isPublisherAlive() const;
+};
+
+#endif
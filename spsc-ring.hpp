@@ -0,0 +1,109 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#ifndef H_SPSC_RING
+#define H_SPSC_RING
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// a fixed size, lock free, single producer / single consumer ring of preallocated slots
+// notes 1, the producer writes into the slot returned by acquireWrite() and then publishes it using commitWrite()
+//       2, the consumer reads from the slot returned by acquireRead() or acquireLatest() and then releases it using commitRead()
+//       3, the slots are never destroyed or re-created, so any resources that they hold (i.e. cv::Mat buffers) are reused
+//       4, head and tail are free running counters, i.e. they are only ever reduced modulo the capacity when indexing the slots
+//
+template <typename T>
+class SpscRing
+{
+    private:
+        std::vector<T> slots;
+        alignas(64) std::atomic<uint64_t> head = 0;
+        alignas(64) std::atomic<uint64_t> tail = 0;
+        uint64_t readIndex = 0;
+
+    public:
+        SpscRing(const size_t capacity):
+            slots(capacity)
+        {
+        }
+
+        size_t capacity() const
+        {
+            return slots.size();
+        }
+
+        size_t size() const
+        {
+            // note, tail must be read first, head can only ever move further ahead of it
+            //
+            const uint64_t oldest = tail.load(std::memory_order_acquire);
+            return head.load(std::memory_order_acquire) - oldest;
+        }
+
+        bool empty() const
+        {
+            return size() == 0;
+        }
+
+        // producer only, returns nullptr if the ring is full
+        //
+        T* acquireWrite()
+        {
+            const uint64_t index = head.load(std::memory_order_relaxed);
+            if ((index - tail.load(std::memory_order_acquire)) >= slots.size()) return nullptr;
+
+            return &slots[index % slots.size()];
+        }
+
+        // producer only, publishes the slot returned by the last acquireWrite()
+        //
+        void commitWrite()
+        {
+            head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_seq_cst);
+        }
+
+        // consumer only, returns the oldest slot or nullptr if the ring is empty
+        //
+        T* acquireRead()
+        {
+            readIndex = tail.load(std::memory_order_relaxed);
+            if (readIndex == head.load(std::memory_order_acquire)) return nullptr;
+
+            return &slots[readIndex % slots.size()];
+        }
+
+        // consumer only, returns the newest slot or nullptr if the ring is empty
+        // note, all of the older slots are released back to the producer, skipped is set to the number of discarded slots
+        //
+        T* acquireLatest(size_t& skipped)
+        {
+            const uint64_t oldest = tail.load(std::memory_order_relaxed);
+            const uint64_t newest = head.load(std::memory_order_acquire);
+            if (oldest == newest)
+            {
+                skipped = 0;
+                return nullptr;
+            }
+
+            // note, the newest slot can't be overwritten by the producer as the ring would need to be full for it to wrap onto it
+            //
+            readIndex = newest - 1;
+            skipped = readIndex - oldest;
+            tail.store(readIndex, std::memory_order_release);
+
+            return &slots[readIndex % slots.size()];
+        }
+
+        // consumer only, releases the slot returned by the last acquireRead() or acquireLatest()
+        //
+        void commitRead()
+        {
+            tail.store(readIndex + 1, std::memory_order_release);
+        }
+};
+
+#endif
@@ -0,0 +1,56 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#include <algorithm>
+#include <cstring>
+
+#include <sched.h>
+
+#include "thread-scheduling.hpp"
+
+bool ThreadScheduling::isDefault() const
+{
+    return cpus.empty() && (policy == Policy::OTHER);
+}
+
+bool ThreadScheduling::apply(const pthread_t thread, std::string& error) const
+{
+    // note, both are attempted even if the affinity fails, the reasons are combined
+    //
+    error.clear();
+    if (!cpus.empty())
+    {
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        for (const auto cpu : cpus) if ((cpu >= 0) && (cpu < CPU_SETSIZE)) CPU_SET(cpu, &cpuSet);
+
+        const int32_t result = pthread_setaffinity_np(thread, sizeof(cpuSet), &cpuSet);
+        if (result != 0) error = std::string("unable to set the CPU affinity, reason: ") + strerror(result);
+    }
+
+    if (policy == Policy::OTHER)
+    {
+        // note, only a real time thread is changed, i.e. a thread that is already SCHED_OTHER (or SCHED_BATCH etc.) keeps its policy and nice value
+        //
+        int32_t currentPolicy = SCHED_OTHER;
+        sched_param parameters = {};
+        if ((pthread_getschedparam(thread, &currentPolicy, &parameters) == 0) && ((currentPolicy == SCHED_FIFO) || (currentPolicy == SCHED_RR)))
+        {
+            parameters.sched_priority = 0;
+            const int32_t result = pthread_setschedparam(thread, SCHED_OTHER, &parameters);
+            if (result != 0) error += std::string(error.empty() ? "" : ", ") + "unable to restore the SCHED_OTHER scheduling policy, reason: " + strerror(result);
+        }
+    }
+    else
+    {
+        const int32_t nativePolicy = (policy == Policy::FIFO) ? SCHED_FIFO : SCHED_RR;
+        sched_param parameters = {};
+        parameters.sched_priority = std::clamp(priority, sched_get_priority_min(nativePolicy), sched_get_priority_max(nativePolicy));
+
+        const int32_t result = pthread_setschedparam(thread, nativePolicy, &parameters);
+        if (result != 0) error += std::string(error.empty() ? "" : ", ") + "unable to set the real time scheduling policy, reason: " + strerror(result);
+    }
+
+    return error.empty();
+}
@@ -0,0 +1,34 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#ifndef H_THREAD_SCHEDULING
+#define H_THREAD_SCHEDULING
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+
+// the CPU affinity and scheduling policy of a thread, see GigEVideoCapture::setThreadScheduling()
+// notes 1, an empty cpus list leaves the affinity unchanged, otherwise the thread may only run on the listed cores
+//       2, FIFO and RR are the real time policies, priority is clamped to their range (i.e. 1 to 99 on linux)
+//          they require CAP_SYS_NICE or an rtprio limit (see /etc/security/limits.conf)
+//          OTHER returns a real time thread to SCHED_OTHER (priority 0), i.e. undoes a previous FIFO or RR, any other policy is left unchanged
+//       3, apply() never throws, it returns false with the reason if the affinity or the policy could not be set
+//          i.e. the thread simply continues with its existing scheduling
+//
+struct ThreadScheduling
+{
+    enum class Policy { OTHER, FIFO, RR };
+
+    std::vector<int32_t> cpus;
+    Policy policy = Policy::OTHER;
+    int32_t priority = 0;
+
+    bool isDefault() const;
+    bool apply(const pthread_t thread, std::string& error) const;
+};
+
+#endif
@@ -0,0 +1,85 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#ifndef H_TYPED_GIGE_VIDEO_CAPTURE
+#define H_TYPED_GIGE_VIDEO_CAPTURE
+
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include <opencv2/opencv.hpp>
+
+#include "gige-video-capture.hpp"
+#include "pixel-format.hpp"
+
+// a GigEVideoCapture for a pixel format known at compile time, i.e. TypedGigEVideoCapture<Gray8> or TypedGigEVideoCapture<BayerGBRG8, BGR8>
+// notes 1, the Format is the format captured, the Output (by default the Format) is the format grabbed, i.e. a bayer format can be converted to BGR8 or Gray8 (of the same depth)
+//       2, the primary appsink is restricted to the Format's caps, so a pipeline whose capsfilter can't produce the format throws when it is constructed
+//          and any other mismatch fails the caps negotiation on start(), i.e. a frame of the wrong type is never delivered
+//          each negotiated format is also checked against the Format (see PixelFormat::matches()), a format that doesn't match stops the pipeline with an error
+//       3, the frames are grabbed as cv::Mat_<Output::Pixel>, the untyped grab(cv::Mat&) methods are hidden as is setOutputConversion(), the conversion is fixed by the Output
+//       4, the frame statistics, the frame copies and the bayer conversion use the kernels specialised for the Format (and Output), see restrictFormat()
+//
+template <typename Format, typename Output = Format>
+class TypedGigEVideoCapture: public GigEVideoCapture
+{
+    static_assert(std::is_same_v<Format, Output> || (Format::isBayer && !Output::isBayer && (Output::depth == Format::depth) && ((Output::channels == 1) || (Output::channels == 3))),
+        "The output must be the captured format, or a gray or BGR conversion of a bayer format of the same depth");
+
+    public:
+        using Pixel = typename Output::Pixel;
+        using Frame = cv::Mat_<Pixel>;
+
+        TypedGigEVideoCapture(const std::string_view pipeline, const std::string& primarySink = ""):
+            GigEVideoCapture(pipeline, primarySink)
+        {
+            std::string error;
+            if (!restrictFormat(Format::caps, &Format::matches, Format::statisticsKernel(), &Format::copy, conversionKernel(), error)) throw error;
+
+            if constexpr (!std::is_same_v<Format, Output>)
+            {
+                GigEVideoCapture::setOutputConversion(conversion);
+            }
+        }
+
+        bool grab(Frame& frame)
+        {
+            return GigEVideoCapture::grab(frame);
+        }
+
+        bool grab(Frame& frame, const GrabPolicy policy)
+        {
+            return GigEVideoCapture::grab(frame, policy);
+        }
+
+        bool tryGrab(Frame& frame, const std::chrono::milliseconds timeout, const GrabPolicy policy = GrabPolicy::LATEST)
+        {
+            return GigEVideoCapture::tryGrab(frame, timeout, policy);
+        }
+
+        bool grabView(const std::string& name, Frame& view, const GrabPolicy policy = GrabPolicy::LATEST)
+        {
+            return GigEVideoCapture::grabView(name, view, policy);
+        }
+
+        static constexpr int32_t frameType()
+        {
+            return Output::type;
+        }
+
+    private:
+        static constexpr BayerConverter::Output conversion = (Output::channels == 3) ? BayerConverter::Output::BGR : BayerConverter::Output::GRAY;
+
+        static BayerConverter::Kernel conversionKernel()
+        {
+            if constexpr (std::is_same_v<Format, Output>) return nullptr;
+            else return &BayerConverter::convert<Format::bayerPattern, conversion>;
+        }
+
+        using GigEVideoCapture::setOutputConversion;
+};
+
+#endif
@@ -0,0 +1,55 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#include "zero-copy-allocator.hpp"
+
+cv::Mat ZeroCopyAllocator::wrap(void* data, const int32_t rows, const int32_t cols, const int32_t type, const size_t step, std::shared_ptr<void> owner)
+{
+    // notes 1, this follows the same approach as the OpenCV python bindings (i.e. the NumpyAllocator)
+    //       2, the cv::Mat is created as a header for the external data, the UMatData then provides it with a reference count
+    //       3, the owner is stored as the userdata and will be destroyed in deallocate(), i.e. when the reference count reaches zero
+    //
+    auto frame = cv::Mat(rows, cols, type, data, step);
+
+    cv::UMatData* u = new cv::UMatData(&instance());
+    u->data = u->origdata = static_cast<uchar*>(data);
+    u->size = step * rows;
+    u->userdata = new std::shared_ptr<void>(std::move(owner));
+
+    frame.u = u;
+    frame.allocator = &instance();
+    frame.addref();
+
+    return frame;
+}
+
+cv::UMatData* ZeroCopyAllocator::allocate(int dims, const int* sizes, int type, void* data, size_t* step, cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const
+{
+    // a wrapped cv::Mat is being re-created, i.e. cv::cvtColor(frame, frame, ...), so let OpenCV allocate as normal
+    //
+    return cv::Mat::getStdAllocator()->allocate(dims, sizes, type, data, step, flags, usageFlags);
+}
+
+bool ZeroCopyAllocator::allocate(cv::UMatData* data, cv::AccessFlag accessFlags, cv::UMatUsageFlags usageFlags) const
+{
+    // note, the wrapped data is always present, there is nothing to allocate
+    //
+    return data != nullptr;
+}
+
+void ZeroCopyAllocator::deallocate(cv::UMatData* data) const
+{
+    if (data == nullptr) return;
+
+    // releasing the owner will unmap and release the external memory, i.e. return the GstBuffer to its pool
+    //
+    delete static_cast<std::shared_ptr<void>*>(data->userdata);
+    delete data;
+}
+
+ZeroCopyAllocator& ZeroCopyAllocator::instance()
+{
+    static ZeroCopyAllocator allocator;
+    return allocator;
+}
@@ -0,0 +1,30 @@
+//
+// (c) Bit Parallel Ltd (Max van Daalen), March 2022
+//
+
+#ifndef H_ZERO_COPY_ALLOCATOR
+#define H_ZERO_COPY_ALLOCATOR
+
+#include <cstdint>
+#include <memory>
+
+#include <opencv2/opencv.hpp>
+
+// a cv::MatAllocator that allows a cv::Mat to reference externally owned memory (i.e. a mapped GstBuffer)
+// notes 1, the owner is held by the cv::Mat reference count and is released when the last cv::Mat copy is released
+//       2, any re-allocation of a wrapped cv::Mat (i.e. cv::Mat::create() with a different size or type) is delegated to the standard allocator
+//
+class ZeroCopyAllocator : public cv::MatAllocator
+{
+    public:
+        static cv::Mat wrap(void* data, const int32_t rows, const int32_t cols, const int32_t type, const size_t step, std::shared_ptr<void> owner);
+
+        cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step, cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override;
+        bool allocate(cv::UMatData* data, cv::AccessFlag accessFlags, cv::UMatUsageFlags usageFlags) const override;
+        void deallocate(cv::UMatData* data) const override;
+
+    private:
+        static ZeroCopyAllocator& instance();
+};
+
+#endif